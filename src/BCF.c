@@ -0,0 +1,51 @@
+// File: BCF.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Encode BCF2 headers and records.
+
+#include "BCF.h"
+
+// Typed value descriptors: a count in the high nibble and a type in the low nibble.
+#define BCF_INT8 1
+#define BCF_CHAR 7
+#define BCF_TYPE(count, type) ((char) (((count) << 4) | (type)))
+
+// The bits of a missing QUAL.
+#define BCF_MISSING_FLOAT 0x7F800001
+
+// Appends little-endian integers to the buffer.
+static inline void put32(kstring_t* buffer, uint32_t x) {
+    char b[4] = { x, x >> 8, x >> 16, x >> 24 };
+    kputsn(b, 4, buffer);
+}
+
+void format_bcf_header(kstring_t* buffer, kstring_t* text) {
+    kputsn("BCF\2\2", 5, buffer);
+    put32(buffer, ks_len(text) + 1);
+    kputsn(ks_str(text), ks_len(text) + 1, buffer);
+}
+
+void format_bcf_prefix(kstring_t* buffer, int tid, int pos, int numIndividuals) {
+    // CHROM, POS, rlen, QUAL, counts, ID, two alleles, and an empty FILTER.
+    const uint32_t sharedLength = 24 + 1 + 2 + 2 + 1;
+    // The GT key, the type of its values, and two alleles per individual.
+    const uint32_t individualLength = 3 + 2 * numIndividuals;
+    put32(buffer, sharedLength);
+    put32(buffer, individualLength);
+    put32(buffer, tid);
+    put32(buffer, pos - 1);
+    put32(buffer, 1);
+    put32(buffer, BCF_MISSING_FLOAT);
+    // No INFO fields and two alleles.
+    put32(buffer, 2 << 16);
+    // One FORMAT field.
+    put32(buffer, (1 << 24) | numIndividuals);
+    kputc_(BCF_TYPE(0, BCF_CHAR), buffer);
+    kputc_(BCF_TYPE(1, BCF_CHAR), buffer); kputc_('A', buffer);
+    kputc_(BCF_TYPE(1, BCF_CHAR), buffer); kputc_('T', buffer);
+    kputc_(BCF_TYPE(0, 0), buffer);
+    // GT is string 1 of the dictionary.
+    kputc_(BCF_TYPE(1, BCF_INT8), buffer); kputc_(1, buffer);
+    kputc_(BCF_TYPE(2, BCF_INT8), buffer);
+}
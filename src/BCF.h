@@ -0,0 +1,47 @@
+// File: BCF.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Encode BCF2 headers and records.
+
+#ifndef _BCF_H_
+#define _BCF_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../lib/kstring.h"
+
+// The FILTER and FORMAT lines BCF needs in the header. PASS and GT
+//  are the first two strings of the header dictionary.
+#define BCF_HEADER_LINES "##FILTER=<ID=PASS,Description=\"All filters passed\">\n##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+
+// Encode an allele as a BCF GT value.
+// Accepts:
+//  char allele -> The allele as it would appear in VCF. Anything but a digit is missing.
+//  bool phased -> If set, the allele is phased with the preceding allele.
+// Returns: char, the encoded allele.
+static inline char encode_bcf_allele(char allele, bool phased) {
+    int index = allele >= '0' && allele <= '9' ? allele - '0' + 1 : 0;
+    return (char) ((index << 1) | phased);
+}
+
+// Append the BCF magic and the header text.
+// Accepts:
+//  kstring_t* buffer -> The buffer to append to.
+//  kstring_t* text -> The VCF header text, including BCF_HEADER_LINES.
+// Returns: void.
+void format_bcf_header(kstring_t* buffer, kstring_t* text);
+
+// Append the fixed fields of a biallelic A/T record on the first contig,
+//  followed by the GT key and type of the genotype values.
+// Accepts:
+//  kstring_t* buffer -> The buffer to append to.
+//  int tid -> The index of the record's contig in the header.
+//  int pos -> The 1-based position of the record.
+//  int numIndividuals -> The number of diploid individuals.
+// Returns: void.
+void format_bcf_prefix(kstring_t* buffer, int tid, int pos, int numIndividuals);
+
+#endif
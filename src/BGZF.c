@@ -0,0 +1,455 @@
+// File: BGZF.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Write BGZF and seekable zstd files, compressing blocks in parallel on a shared pool of threads.
+
+#include "BGZF.h"
+
+// The gzip header of a block. The last two bytes hold the block size minus one.
+static const uint8_t BGZF_HEADER[18] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+
+// An empty block marking the end of the file.
+static const uint8_t BGZF_EOF[28] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+// The names of the zlib strategies, Z_DEFAULT_STRATEGY through Z_FIXED.
+static const char* STRATEGY_NAMES[] = { "default", "filtered", "huffman", "rle", "fixed" };
+#define NUM_STRATEGIES 5
+
+// The magic numbers of a skippable frame and of the footer of a zstd seek table.
+#define ZSTD_SKIPPABLE_MAGIC 0x184D2A5E
+#define ZSTD_SEEKABLE_MAGIC 0x8F92EAB1
+
+// The state a thread keeps to compress blocks with one setting.
+struct Compressor_t {
+    Compression_t compression;
+    z_stream* stream;
+    #ifdef HAVE_ZSTD
+    ZSTD_CCtx* context;
+    #endif
+};
+
+struct HeaderCache_t {
+    pthread_mutex_t lock;
+    // The header and its blocks.
+    kstring_t data;
+    kstring_t blocks;
+    // The compressed size of each block.
+    kvec_t(uint32_t) sizes;
+    Compression_t compression;
+};
+
+// Stores a 32-bit integer in little-endian order.
+static inline void put_le32(uint8_t* p, uint32_t x) {
+    p[0] = x; p[1] = x >> 8; p[2] = x >> 16; p[3] = x >> 24;
+}
+
+// Creates a raw deflate stream.
+// Accepts:
+//  int level -> The compression level.
+//  int strategy -> The zlib strategy.
+// Returns: z_stream*, the stream.
+static z_stream* init_stream(int level, int strategy) {
+    z_stream* stream = calloc(1, sizeof(z_stream));
+    deflateInit2(stream, level, Z_DEFLATED, -15, 8, strategy);
+    return stream;
+}
+
+// Frees a raw deflate stream.
+static void destroy_stream(z_stream* stream) {
+    deflateEnd(stream);
+    free(stream);
+}
+
+// Checks if two settings compress blocks the same way.
+static inline bool same_compression(Compression_t a, Compression_t b) {
+    return a.format == b.format && a.level == b.level && a.strategy == b.strategy && a.longMatching == b.longMatching;
+}
+
+// Gets the most uncompressed bytes in a block.
+// Accepts:
+//  Compression_t compression -> The setting.
+// Returns: size_t, the block size.
+static size_t get_block_size(Compression_t compression) {
+    if (compression.format == FORMAT_ZSTD)
+        return compression.longMatching ? ZSTD_LONG_FRAME_SIZE : ZSTD_FRAME_SIZE;
+    return BGZF_BLOCK_SIZE;
+}
+
+// Creates the state to compress blocks with a setting.
+// Accepts:
+//  Compression_t compression -> The setting.
+// Returns: Compressor_t*, the state.
+static Compressor_t* init_compressor(Compression_t compression) {
+    Compressor_t* compressor = calloc(1, sizeof(Compressor_t));
+    compressor -> compression = compression;
+    #ifdef HAVE_ZSTD
+    if (compression.format == FORMAT_ZSTD) {
+        compressor -> context = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter(compressor -> context, ZSTD_c_compressionLevel, compression.level);
+        if (compression.longMatching) {
+            ZSTD_CCtx_setParameter(compressor -> context, ZSTD_c_enableLongDistanceMatching, 1);
+            ZSTD_CCtx_setParameter(compressor -> context, ZSTD_c_windowLog, 24);
+        }
+        return compressor;
+    }
+    #endif
+    compressor -> stream = init_stream(compression.level, compression.strategy);
+    return compressor;
+}
+
+// Frees the state to compress blocks.
+static void destroy_compressor(Compressor_t* compressor) {
+    if (compressor -> stream != NULL)
+        destroy_stream(compressor -> stream);
+    #ifdef HAVE_ZSTD
+    if (compressor -> context != NULL)
+        ZSTD_freeCCtx(compressor -> context);
+    #endif
+    free(compressor);
+}
+
+// Compresses a job's data into a BGZF block or a zstd frame.
+// Accepts:
+//  Compressor_t* compressor -> The state for the job's setting.
+//  BGZFJob_t* job -> The job to compress.
+// Returns: void.
+static void compress_job(Compressor_t* compressor, BGZFJob_t* job) {
+    kstring_t* block = &(job -> block);
+    #ifdef HAVE_ZSTD
+    if (compressor -> compression.format == FORMAT_ZSTD) {
+        size_t bound = ZSTD_compressBound(ks_len(&(job -> data)));
+        ks_resize(block, bound);
+        size_t size = ZSTD_compress2(compressor -> context, ks_str(block), bound, ks_str(&(job -> data)), ks_len(&(job -> data)));
+        // The bound always fits, so this only fails if memory runs out.
+        if (ZSTD_isError(size)) {
+            fprintf(stderr, "zstd failed: %s\n", ZSTD_getErrorName(size));
+            exit(1);
+        }
+        block -> l = size;
+        return;
+    }
+    #endif
+    z_stream* stream = compressor -> stream;
+    ks_resize(block, BGZF_MAX_BLOCK_SIZE);
+    uint8_t* out = (uint8_t*) ks_str(block);
+    memcpy(out, BGZF_HEADER, sizeof(BGZF_HEADER));
+    deflateReset(stream);
+    stream -> next_in = (Bytef*) ks_str(&(job -> data));
+    stream -> avail_in = ks_len(&(job -> data));
+    stream -> next_out = out + sizeof(BGZF_HEADER);
+    stream -> avail_out = BGZF_MAX_BLOCK_SIZE - sizeof(BGZF_HEADER) - 8;
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+        // Incompressible data did not fit, so store it instead.
+        z_stream* stored = init_stream(0, Z_DEFAULT_STRATEGY);
+        stored -> next_in = (Bytef*) ks_str(&(job -> data));
+        stored -> avail_in = ks_len(&(job -> data));
+        stored -> next_out = out + sizeof(BGZF_HEADER);
+        stored -> avail_out = BGZF_MAX_BLOCK_SIZE - sizeof(BGZF_HEADER) - 8;
+        deflate(stored, Z_FINISH);
+        stream -> total_out = stored -> total_out;
+        destroy_stream(stored);
+    }
+    size_t size = sizeof(BGZF_HEADER) + stream -> total_out + 8;
+    out[16] = (size - 1) & 0xff; out[17] = (size - 1) >> 8;
+    put_le32(out + size - 8, crc32(crc32(0, NULL, 0), (Bytef*) ks_str(&(job -> data)), ks_len(&(job -> data))));
+    put_le32(out + size - 4, ks_len(&(job -> data)));
+    block -> l = size;
+}
+
+// A thread of the compression pool. Compresses jobs until the pool is closed.
+// Accepts:
+//  void* arg -> The CompressionPool_t*.
+// Returns: void*, NULL.
+static void* compress_jobs(void* arg) {
+    CompressionPool_t* pool = (CompressionPool_t*) arg;
+    Compressor_t* compressor = NULL;
+    BGZFJob_t* job;
+    while ((job = pop_queue(pool -> jobs)) != NULL) {
+        if (compressor == NULL || !same_compression(compressor -> compression, job -> owner -> compression)) {
+            if (compressor != NULL) destroy_compressor(compressor);
+            compressor = init_compressor(job -> owner -> compression);
+        }
+        compress_job(compressor, job);
+        pthread_mutex_lock(&(job -> owner -> lock));
+        job -> done = true;
+        pthread_cond_broadcast(&(job -> owner -> done));
+        pthread_mutex_unlock(&(job -> owner -> lock));
+    }
+    if (compressor != NULL)
+        destroy_compressor(compressor);
+    return NULL;
+}
+
+CompressionPool_t* init_compression_pool(int numThreads) {
+    CompressionPool_t* pool = calloc(1, sizeof(CompressionPool_t));
+    pool -> numThreads = numThreads;
+    pool -> jobs = init_queue(4 * numThreads);
+    pool -> threads = malloc(numThreads * sizeof(pthread_t));
+    for (int i = 0; i < numThreads; i++)
+        pthread_create(&(pool -> threads[i]), NULL, compress_jobs, pool);
+    return pool;
+}
+
+void destroy_compression_pool(CompressionPool_t* pool) {
+    if (pool == NULL)
+        return;
+    close_queue(pool -> jobs);
+    for (int i = 0; i < pool -> numThreads; i++)
+        pthread_join(pool -> threads[i], NULL);
+    destroy_queue(pool -> jobs);
+    free(pool -> threads);
+    free(pool);
+}
+
+BGZF_t* init_bgzf(char* fileName, Compression_t compression, CompressionPool_t* pool) {
+    // "-" is standard output.
+    FILE* fp = strcmp(fileName, "-") == 0 ? stdout : fopen(fileName, "wb");
+    if (fp == NULL)
+        return NULL;
+    BGZF_t* bgzf = calloc(1, sizeof(BGZF_t));
+    bgzf -> fp = fp;
+    bgzf -> compression = compression;
+    bgzf -> blockSize = get_block_size(compression);
+    bgzf -> pool = pool;
+    // Two blocks per thread keeps the pool busy while the oldest block is written.
+    bgzf -> capacity = pool == NULL ? 1 : 2 * pool -> numThreads;
+    bgzf -> inFlight = calloc(bgzf -> capacity, sizeof(BGZFJob_t*));
+    bgzf -> spare = calloc(bgzf -> capacity, sizeof(BGZFJob_t*));
+    for (int i = 0; i < bgzf -> capacity; i++) {
+        bgzf -> spare[i] = calloc(1, sizeof(BGZFJob_t));
+        bgzf -> spare[i] -> owner = bgzf;
+        ks_resize(&(bgzf -> spare[i] -> data), bgzf -> blockSize);
+    }
+    bgzf -> numSpare = bgzf -> capacity;
+    bgzf -> current = calloc(1, sizeof(BGZFJob_t));
+    bgzf -> current -> owner = bgzf;
+    ks_resize(&(bgzf -> current -> data), bgzf -> blockSize);
+    kv_init(bgzf -> blocks);
+    kv_init(bgzf -> lengths);
+    pthread_mutex_init(&(bgzf -> lock), NULL);
+    pthread_cond_init(&(bgzf -> done), NULL);
+    return bgzf;
+}
+
+// Waits for the oldest block in flight, writes it, and makes its job spare.
+// Accepts:
+//  BGZF_t* bgzf -> The file.
+// Returns: void.
+static void write_oldest(BGZF_t* bgzf) {
+    BGZFJob_t* job = bgzf -> inFlight[bgzf -> head];
+    pthread_mutex_lock(&(bgzf -> lock));
+    while (!job -> done)
+        pthread_cond_wait(&(bgzf -> done), &(bgzf -> lock));
+    pthread_mutex_unlock(&(bgzf -> lock));
+    fwrite(ks_str(&(job -> block)), 1, ks_len(&(job -> block)), bgzf -> fp);
+    kv_push(uint64_t, bgzf -> blocks, bgzf -> address);
+    kv_push(uint32_t, bgzf -> lengths, ks_len(&(job -> data)));
+    bgzf -> address += ks_len(&(job -> block));
+    bgzf -> head = (bgzf -> head + 1) % bgzf -> capacity;
+    bgzf -> size--;
+    job -> data.l = 0;
+    job -> done = false;
+    bgzf -> spare[bgzf -> numSpare++] = job;
+}
+
+// Compresses the block being filled and starts a new one.
+// Accepts:
+//  BGZF_t* bgzf -> The file.
+// Returns: void.
+static void submit_current(BGZF_t* bgzf) {
+    if (bgzf -> size == bgzf -> capacity)
+        write_oldest(bgzf);
+    BGZFJob_t* job = bgzf -> current;
+    bgzf -> inFlight[(bgzf -> head + bgzf -> size) % bgzf -> capacity] = job;
+    bgzf -> size++;
+    bgzf -> current = bgzf -> spare[--bgzf -> numSpare];
+    if (bgzf -> pool != NULL) {
+        push_queue(bgzf -> pool -> jobs, job);
+    } else {
+        if (bgzf -> compressor == NULL)
+            bgzf -> compressor = init_compressor(bgzf -> compression);
+        compress_job(bgzf -> compressor, job);
+        job -> done = true;
+    }
+}
+
+void write_bgzf(BGZF_t* bgzf, const char* data, size_t length) {
+    while (length > 0) {
+        kstring_t* current = &(bgzf -> current -> data);
+        size_t count = bgzf -> blockSize - ks_len(current);
+        if (count > length)
+            count = length;
+        memcpy(ks_str(current) + ks_len(current), data, count);
+        current -> l += count;
+        data += count;
+        length -= count;
+        if (ks_len(current) == bgzf -> blockSize)
+            submit_current(bgzf);
+    }
+}
+
+int parse_strategy(const char* name) {
+    for (int i = 0; i < NUM_STRATEGIES; i++)
+        if (strcmp(name, STRATEGY_NAMES[i]) == 0)
+            return i;
+    return -1;
+}
+
+const char* get_strategy_name(int strategy) {
+    return strategy >= 0 && strategy < NUM_STRATEGIES ? STRATEGY_NAMES[strategy] : "unknown";
+}
+
+double time_compression(const char* data, size_t length, Compression_t compression, size_t* compressedLength) {
+    size_t blockSize = get_block_size(compression);
+    BGZFJob_t job = { 0 };
+    ks_resize(&(job.data), blockSize);
+    Compressor_t* compressor = init_compressor(compression);
+    *compressedLength = 0;
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t offset = 0; offset < length; offset += blockSize) {
+        job.data.l = length - offset < blockSize ? length - offset : blockSize;
+        memcpy(job.data.s, data + offset, job.data.l);
+        compress_job(compressor, &job);
+        *compressedLength += ks_len(&(job.block));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    destroy_compressor(compressor);
+    free(job.data.s);
+    free(job.block.s);
+    return (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+HeaderCache_t* init_header_cache() {
+    HeaderCache_t* cache = calloc(1, sizeof(HeaderCache_t));
+    pthread_mutex_init(&(cache -> lock), NULL);
+    kv_init(cache -> sizes);
+    return cache;
+}
+
+void destroy_header_cache(HeaderCache_t* cache) {
+    if (cache == NULL)
+        return;
+    pthread_mutex_destroy(&(cache -> lock));
+    free(cache -> data.s);
+    free(cache -> blocks.s);
+    kv_destroy(cache -> sizes);
+    free(cache);
+}
+
+void write_bgzf_header(BGZF_t* bgzf, HeaderCache_t* cache, const char* data, size_t length) {
+    // Without a shared cache, the header is compressed into one of its own.
+    HeaderCache_t* owned = cache == NULL ? init_header_cache() : NULL;
+    if (cache == NULL)
+        cache = owned;
+    pthread_mutex_lock(&(cache -> lock));
+    if (ks_len(&(cache -> blocks)) == 0 || !same_compression(cache -> compression, bgzf -> compression) || ks_len(&(cache -> data)) != length || memcmp(ks_str(&(cache -> data)), data, length) != 0) {
+        // Compress the header on the calling thread and keep its blocks.
+        BGZFJob_t job = { 0 };
+        ks_resize(&(job.data), bgzf -> blockSize);
+        Compressor_t* compressor = init_compressor(bgzf -> compression);
+        cache -> data.l = cache -> blocks.l = 0;
+        kv_size(cache -> sizes) = 0;
+        for (size_t offset = 0; offset < length; offset += bgzf -> blockSize) {
+            job.data.l = length - offset < bgzf -> blockSize ? length - offset : bgzf -> blockSize;
+            memcpy(job.data.s, data + offset, job.data.l);
+            compress_job(compressor, &job);
+            kputsn(ks_str(&(job.block)), ks_len(&(job.block)), &(cache -> blocks));
+            kv_push(uint32_t, cache -> sizes, ks_len(&(job.block)));
+        }
+        kputsn(data, length, &(cache -> data));
+        cache -> compression = bgzf -> compression;
+        destroy_compressor(compressor);
+        free(job.data.s);
+        free(job.block.s);
+    }
+    fwrite(ks_str(&(cache -> blocks)), 1, ks_len(&(cache -> blocks)), bgzf -> fp);
+    for (int i = 0; i < kv_size(cache -> sizes); i++) {
+        size_t offset = (size_t) i * bgzf -> blockSize;
+        kv_push(uint64_t, bgzf -> blocks, bgzf -> address);
+        kv_push(uint32_t, bgzf -> lengths, length - offset < bgzf -> blockSize ? length - offset : bgzf -> blockSize);
+        bgzf -> address += kv_A(cache -> sizes, i);
+        bgzf -> numHeaderBlocks++;
+    }
+    pthread_mutex_unlock(&(cache -> lock));
+    bgzf -> headerLength = length;
+    destroy_header_cache(owned);
+}
+
+// Frees a job and its buffers.
+static void destroy_job(BGZFJob_t* job) {
+    free(job -> data.s);
+    free(job -> block.s);
+    free(job);
+}
+
+void finish_bgzf(BGZF_t* bgzf) {
+    if (ks_len(&(bgzf -> current -> data)) > 0)
+        submit_current(bgzf);
+    while (bgzf -> size > 0)
+        write_oldest(bgzf);
+}
+
+uint64_t get_virtual_offset(BGZF_t* bgzf, uint64_t offset) {
+    size_t block = offset / bgzf -> blockSize;
+    // Past the header, blocks are counted from the end of the header blocks.
+    if (offset >= bgzf -> headerLength) {
+        offset -= bgzf -> headerLength;
+        block = bgzf -> numHeaderBlocks + offset / bgzf -> blockSize;
+    }
+    // The end of the data may fall at the start of the end-of-file marker.
+    if (block >= kv_size(bgzf -> blocks))
+        return bgzf -> address << 16;
+    return kv_A(bgzf -> blocks, block) << 16 | offset % bgzf -> blockSize;
+}
+
+// Writes the seek table of a zstd file, a skippable frame listing the compressed
+//  and uncompressed size of every frame, followed by a footer.
+// Accepts:
+//  BGZF_t* bgzf -> The file, with every frame written.
+// Returns: void.
+static void write_seek_table(BGZF_t* bgzf) {
+    int numFrames = kv_size(bgzf -> blocks);
+    size_t size = 8 + 8 * (size_t) numFrames + 9;
+    uint8_t* table = malloc(size);
+    put_le32(table, ZSTD_SKIPPABLE_MAGIC);
+    put_le32(table + 4, size - 8);
+    for (int i = 0; i < numFrames; i++) {
+        uint64_t next = i + 1 < numFrames ? kv_A(bgzf -> blocks, i + 1) : bgzf -> address;
+        put_le32(table + 8 + 8 * i, next - kv_A(bgzf -> blocks, i));
+        put_le32(table + 12 + 8 * i, kv_A(bgzf -> lengths, i));
+    }
+    // The number of frames, a descriptor without checksums, and the magic number.
+    put_le32(table + size - 9, numFrames);
+    table[size - 5] = 0;
+    put_le32(table + size - 4, ZSTD_SEEKABLE_MAGIC);
+    fwrite(table, 1, size, bgzf -> fp);
+    free(table);
+}
+
+void close_bgzf(BGZF_t* bgzf) {
+    if (bgzf == NULL)
+        return;
+    finish_bgzf(bgzf);
+    if (bgzf -> compression.format == FORMAT_ZSTD)
+        write_seek_table(bgzf);
+    else
+        fwrite(BGZF_EOF, 1, sizeof(BGZF_EOF), bgzf -> fp);
+    if (bgzf -> fp == stdout)
+        fflush(bgzf -> fp);
+    else
+        fclose(bgzf -> fp);
+    destroy_job(bgzf -> current);
+    for (int i = 0; i < bgzf -> numSpare; i++)
+        destroy_job(bgzf -> spare[i]);
+    if (bgzf -> compressor != NULL)
+        destroy_compressor(bgzf -> compressor);
+    pthread_mutex_destroy(&(bgzf -> lock));
+    pthread_cond_destroy(&(bgzf -> done));
+    kv_destroy(bgzf -> blocks);
+    kv_destroy(bgzf -> lengths);
+    free(bgzf -> inFlight);
+    free(bgzf -> spare);
+    free(bgzf);
+}
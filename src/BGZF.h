@@ -0,0 +1,216 @@
+// File: BGZF.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Write BGZF and seekable zstd files, compressing blocks in parallel on a shared pool of threads.
+
+#ifndef _BGZF_H_
+#define _BGZF_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "Queue.h"
+#include "../lib/kvec.h"
+#include "../lib/zlib.h"
+#include "../lib/kstring.h"
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// The most uncompressed bytes placed in one block. Leaves room for
+//  incompressible data to fit in a 64 KiB block when stored.
+#define BGZF_BLOCK_SIZE 0xff00
+
+// The largest a compressed block can be.
+#define BGZF_MAX_BLOCK_SIZE 0x10000
+
+// The most uncompressed bytes placed in one zstd frame. Frames are compressed
+//  independently, so they are the unit of random access in a seekable file.
+#define ZSTD_FRAME_SIZE 1048576
+
+// With long distance matching, frames are larger so there is history to match against.
+#define ZSTD_LONG_FRAME_SIZE 16777216
+
+// The formats written by a BGZF_t. Both go through the same pipeline of blocks.
+typedef enum {
+    // BGZF blocks of raw deflate in gzip members.
+    FORMAT_BGZF,
+    // zstd frames followed by a seek table in the seekable format.
+    FORMAT_ZSTD
+} BlockFormat_t;
+
+// How blocks are compressed.
+typedef struct {
+    BlockFormat_t format;
+    // The zlib or zstd level.
+    int level;
+    // The zlib strategy.
+    int strategy;
+    // If set, zstd frames are larger and use long distance matching.
+    bool longMatching;
+} Compression_t;
+
+// The state a thread keeps to compress blocks with one setting.
+typedef struct Compressor_t Compressor_t;
+
+// The blocks of the last header written and the setting they were compressed with,
+//  shared by the files of a run so a header repeated across files is compressed once.
+typedef struct HeaderCache_t HeaderCache_t;
+
+// Threads that compress the blocks of any number of BGZF or seekable zstd files.
+typedef struct {
+    // Blocks waiting to be compressed.
+    Queue_t* jobs;
+    pthread_t* threads;
+    int numThreads;
+} CompressionPool_t;
+
+struct BGZF;
+
+// One block of a BGZF file, or one frame of a seekable zstd file.
+typedef struct {
+    struct BGZF* owner;
+    // The uncompressed bytes and the finished block.
+    kstring_t data;
+    kstring_t block;
+    // Set by the compressing thread under the owner's lock.
+    bool done;
+} BGZFJob_t;
+
+// A BGZF file, or a seekable zstd file, being written. Blocks are compressed
+//  in parallel on the pool, if there is one, and written in order. The functions
+//  below that take a BGZF_t write zstd frames in place of BGZF blocks when the
+//  format is FORMAT_ZSTD. Only virtual offsets are specific to BGZF.
+typedef struct BGZF {
+    FILE* fp;
+    // How blocks are compressed. The level and strategy can change until the first block is compressed.
+    Compression_t compression;
+    // The most uncompressed bytes in a block.
+    size_t blockSize;
+    CompressionPool_t* pool;
+    // The compressor used when there is no pool, created with the first block.
+    Compressor_t* compressor;
+    // The block being filled.
+    BGZFJob_t* current;
+    // Blocks handed to the pool, oldest first.
+    BGZFJob_t** inFlight;
+    int capacity;
+    int head;
+    int size;
+    // Blocks ready to be filled.
+    BGZFJob_t** spare;
+    int numSpare;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    // The number of compressed bytes written so far.
+    uint64_t address;
+    // The address of every block written so far. The header is in blocks of its own,
+    //  and every other block but the last holds exactly blockSize bytes, so this
+    //  maps uncompressed offsets to virtual offsets.
+    kvec_t(uint64_t) blocks;
+    // The uncompressed size of every block written so far, for the seek table of a zstd file.
+    kvec_t(uint32_t) lengths;
+    // The number of uncompressed bytes and blocks of the header.
+    uint64_t headerLength;
+    int numHeaderBlocks;
+} BGZF_t;
+
+// Start the threads that compress blocks.
+// Accepts:
+//  int numThreads -> The number of threads.
+// Returns: CompressionPool_t*, the running pool.
+CompressionPool_t* init_compression_pool(int numThreads);
+
+// Stop the pool's threads. Every BGZF file using the pool must be closed first.
+// Accepts:
+//  CompressionPool_t* pool -> The pool.
+// Returns: void.
+void destroy_compression_pool(CompressionPool_t* pool);
+
+// Create a BGZF file, or a seekable zstd file.
+// Accepts:
+//  char* fileName -> The name of the file to create, or "-" for standard output.
+//  Compression_t compression -> The format and how its blocks are compressed.
+//  CompressionPool_t* pool -> The threads compressing blocks, or NULL to compress on the calling thread.
+// Returns: BGZF_t*, the opened file or NULL if the file could not be created.
+BGZF_t* init_bgzf(char* fileName, Compression_t compression, CompressionPool_t* pool);
+
+// Look up a zlib strategy by name.
+// Accepts:
+//  const char* name -> default, filtered, huffman, rle, or fixed.
+// Returns: int, the strategy or -1 if the name is unknown.
+int parse_strategy(const char* name);
+
+// Get the name of a zlib strategy.
+// Accepts:
+//  int strategy -> The strategy.
+// Returns: const char*, the name accepted by parse_strategy.
+const char* get_strategy_name(int strategy);
+
+// Compress data into blocks on the calling thread and throw the blocks away,
+//  to measure how a setting performs on it.
+// Accepts:
+//  const char* data -> The bytes to compress.
+//  size_t length -> The number of bytes.
+//  Compression_t compression -> The setting to measure.
+//  size_t* compressedLength -> Set to the total size of the blocks.
+// Returns: double, the seconds spent compressing.
+double time_compression(const char* data, size_t length, Compression_t compression, size_t* compressedLength);
+
+// Create an empty header cache.
+// Accepts: void.
+// Returns: HeaderCache_t*, the cache.
+HeaderCache_t* init_header_cache();
+
+// Free a header cache.
+// Accepts:
+//  HeaderCache_t* cache -> The cache.
+// Returns: void.
+void destroy_header_cache(HeaderCache_t* cache);
+
+// Write the header of the file in blocks of its own. The cached blocks are reused if the
+//  header and compression match the last header written, and replaced otherwise.
+//  Must be called before anything else is written.
+// Accepts:
+//  BGZF_t* bgzf -> The file.
+//  HeaderCache_t* cache -> The cache shared by the files of the run, or NULL to compress the header alone.
+//  const char* data -> The header.
+//  size_t length -> The number of bytes.
+// Returns: void.
+void write_bgzf_header(BGZF_t* bgzf, HeaderCache_t* cache, const char* data, size_t length);
+
+// Append bytes to the file, splitting them into blocks.
+// Accepts:
+//  BGZF_t* bgzf -> The file.
+//  const char* data -> The bytes to write.
+//  size_t length -> The number of bytes.
+// Returns: void.
+void write_bgzf(BGZF_t* bgzf, const char* data, size_t length);
+
+// Write every pending block, but not the end-of-file marker or seek table.
+//  No more data can be written afterwards.
+// Accepts:
+//  BGZF_t* bgzf -> The file.
+// Returns: void.
+void finish_bgzf(BGZF_t* bgzf);
+
+// Get the BGZF virtual offset of an uncompressed offset. Only valid once the block holding it has been written.
+// Accepts:
+//  BGZF_t* bgzf -> The file.
+//  uint64_t offset -> The number of uncompressed bytes preceding the position.
+// Returns: uint64_t, the block's address shifted left 16 bits plus the offset within the block.
+uint64_t get_virtual_offset(BGZF_t* bgzf, uint64_t offset);
+
+// Write the remaining blocks and the end-of-file marker, or the seek table of a zstd file,
+//  close the file, and free it.
+// Accepts:
+//  BGZF_t* bgzf -> The file.
+// Returns: void.
+void close_bgzf(BGZF_t* bgzf);
+
+#endif
@@ -0,0 +1,227 @@
+// File: Index.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Build tabix (.tbi) and CSI indices while BGZF output is written.
+
+#include "Index.h"
+
+// The format code, sequence column, begin column, end column, comment character,
+//  and skipped lines of the tabix configuration for VCF.
+static const int32_t TABIX_VCF[6] = { 2, 1, 2, 0, '#', 0 };
+
+// Computes the smallest bin containing [beg, end).
+// Accepts:
+//  int64_t beg -> The 0-based start.
+//  int64_t end -> The 0-based end, exclusive.
+//  int depth -> The number of levels below the root.
+// Returns: uint32_t, the bin.
+static uint32_t reg2bin(int64_t beg, int64_t end, int depth) {
+    int s = INDEX_MIN_SHIFT;
+    int t = ((1 << (3 * depth)) - 1) / 7;
+    end--;
+    for (int l = depth; l > 0; l--, s += 3, t -= 1 << (3 * l))
+        if (beg >> s == end >> s)
+            return t + (beg >> s);
+    return 0;
+}
+
+// Computes the first linear window covered by a bin.
+// Accepts:
+//  uint32_t bin -> The bin.
+//  int depth -> The number of levels below the root.
+// Returns: int64_t, the window.
+static int64_t bin2window(uint32_t bin, int depth) {
+    int level = 0;
+    uint32_t first = 0;
+    while (level < depth && bin >= first + (1u << (3 * level))) {
+        first += 1u << (3 * level);
+        level++;
+    }
+    return (int64_t) (bin - first) << (3 * (depth - level));
+}
+
+Index_t* init_index(bool csi, bool tabixMeta, int64_t maxLength) {
+    Index_t* index = calloc(1, sizeof(Index_t));
+    index -> depth = TABIX_DEPTH;
+    while (maxLength > (int64_t) 1 << (INDEX_MIN_SHIFT + 3 * index -> depth))
+        index -> depth++;
+    index -> csi = csi || index -> depth > TABIX_DEPTH;
+    index -> tabixMeta = tabixMeta;
+    kv_init(index -> references);
+    return index;
+}
+
+int add_index_reference(Index_t* index, const char* name) {
+    Reference_t reference;
+    memset(&reference, 0, sizeof(Reference_t));
+    reference.name = strdup(name);
+    kv_init(reference.bins);
+    kv_init(reference.linear);
+    kv_push(Reference_t, index -> references, reference);
+    return kv_size(index -> references) - 1;
+}
+
+void add_index_record(Index_t* index, int tid, int64_t beg, int64_t end, uint64_t start, uint64_t stop) {
+    Reference_t* reference = &kv_A(index -> references, tid);
+    if (reference -> numRecords == 0)
+        reference -> start = start;
+    reference -> end = stop;
+    reference -> numRecords++;
+
+    // Records arrive sorted, so their bin is almost always one of the last few used.
+    uint32_t bin = reg2bin(beg, end, index -> depth);
+    Bin_t* b = NULL;
+    for (int i = (int) kv_size(reference -> bins) - 1; i >= 0; i--) {
+        if (kv_A(reference -> bins, i).bin == bin) { b = &kv_A(reference -> bins, i); break; }
+    }
+    if (b == NULL) {
+        Bin_t newBin;
+        newBin.bin = bin;
+        kv_init(newBin.chunks);
+        kv_push(Bin_t, reference -> bins, newBin);
+        b = &kv_A(reference -> bins, kv_size(reference -> bins) - 1);
+    }
+    // Extend the last chunk if this record directly follows it.
+    if (kv_size(b -> chunks) > 0 && kv_A(b -> chunks, kv_size(b -> chunks) - 1).end == start) {
+        kv_A(b -> chunks, kv_size(b -> chunks) - 1).end = stop;
+    } else {
+        Chunk_t chunk = { start, stop };
+        kv_push(Chunk_t, b -> chunks, chunk);
+    }
+
+    // Record the offset in every window the record overlaps.
+    for (int64_t w = beg >> INDEX_MIN_SHIFT; w <= (end - 1) >> INDEX_MIN_SHIFT; w++) {
+        while (kv_size(reference -> linear) <= (size_t) w)
+            kv_push(uint64_t, reference -> linear, UINT64_MAX);
+        if (start < kv_A(reference -> linear, w))
+            kv_A(reference -> linear, w) = start;
+    }
+}
+
+const char* get_index_extension(Index_t* index) {
+    return index -> csi ? ".csi" : ".tbi";
+}
+
+// Appends little-endian integers to the index.
+static inline void put32(kstring_t* out, uint32_t x) {
+    char b[4] = { x, x >> 8, x >> 16, x >> 24 };
+    kputsn(b, 4, out);
+}
+static inline void put64(kstring_t* out, uint64_t x) {
+    put32(out, (uint32_t) x);
+    put32(out, (uint32_t) (x >> 32));
+}
+
+// Appends the tabix configuration and the contig names.
+// Accepts:
+//  Index_t* index -> The index.
+//  kstring_t* out -> The serialized index.
+// Returns: void.
+static void put_tabix_meta(Index_t* index, kstring_t* out) {
+    int32_t namesLength = 0;
+    for (int i = 0; i < kv_size(index -> references); i++)
+        namesLength += strlen(kv_A(index -> references, i).name) + 1;
+    for (int i = 0; i < 6; i++)
+        put32(out, TABIX_VCF[i]);
+    put32(out, namesLength);
+    for (int i = 0; i < kv_size(index -> references); i++)
+        kputsn(kv_A(index -> references, i).name, strlen(kv_A(index -> references, i).name) + 1, out);
+}
+
+bool write_index(Index_t* index, BGZF_t* data, char* fileName) {
+    kstring_t* out = init_kstring(NULL);
+    int depth = index -> depth;
+    if (index -> csi) {
+        kputsn("CSI\1", 4, out);
+        put32(out, INDEX_MIN_SHIFT);
+        put32(out, depth);
+        if (index -> tabixMeta) {
+            // The auxiliary data is the tabix configuration.
+            kstring_t aux = { 0, 0, NULL };
+            put_tabix_meta(index, &aux);
+            put32(out, ks_len(&aux));
+            kputsn(ks_str(&aux), ks_len(&aux), out);
+            free(aux.s);
+        } else {
+            put32(out, 0);
+        }
+        put32(out, kv_size(index -> references));
+    } else {
+        kputsn("TBI\1", 4, out);
+        put32(out, kv_size(index -> references));
+        put_tabix_meta(index, out);
+    }
+
+    uint32_t pseudoBin = ((1u << (3 * (depth + 1))) - 1) / 7 + 1;
+    for (int i = 0; i < kv_size(index -> references); i++) {
+        Reference_t* reference = &kv_A(index -> references, i);
+
+        // Convert the linear index to virtual offsets. Empty windows take the offset of the next record.
+        uint64_t next = get_virtual_offset(data, reference -> end);
+        for (int w = (int) kv_size(reference -> linear) - 1; w >= 0; w--) {
+            if (kv_A(reference -> linear, w) == UINT64_MAX)
+                kv_A(reference -> linear, w) = next;
+            else
+                next = kv_A(reference -> linear, w) = get_virtual_offset(data, kv_A(reference -> linear, w));
+        }
+
+        put32(out, kv_size(reference -> bins) + (reference -> numRecords > 0 ? 1 : 0));
+        for (int j = 0; j < kv_size(reference -> bins); j++) {
+            Bin_t* b = &kv_A(reference -> bins, j);
+            put32(out, b -> bin);
+            if (index -> csi) {
+                int64_t w = bin2window(b -> bin, depth);
+                put64(out, w < kv_size(reference -> linear) ? kv_A(reference -> linear, w) : 0);
+            }
+            put32(out, kv_size(b -> chunks));
+            for (int k = 0; k < kv_size(b -> chunks); k++) {
+                put64(out, get_virtual_offset(data, kv_A(b -> chunks, k).start));
+                put64(out, get_virtual_offset(data, kv_A(b -> chunks, k).end));
+            }
+        }
+        // The pseudo-bin holds the extent of the contig and its number of records.
+        if (reference -> numRecords > 0) {
+            put32(out, pseudoBin);
+            if (index -> csi)
+                put64(out, 0);
+            put32(out, 2);
+            put64(out, get_virtual_offset(data, reference -> start));
+            put64(out, get_virtual_offset(data, reference -> end));
+            put64(out, reference -> numRecords);
+            put64(out, 0);
+        }
+        if (!index -> csi) {
+            put32(out, kv_size(reference -> linear));
+            for (int w = 0; w < kv_size(reference -> linear); w++)
+                put64(out, kv_A(reference -> linear, w));
+        }
+    }
+    // No records lack coordinates.
+    put64(out, 0);
+
+    BGZF_t* bgzf = init_bgzf(fileName, (Compression_t) { FORMAT_BGZF, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY, false }, NULL);
+    if (bgzf == NULL) {
+        destroy_kstring(out);
+        return false;
+    }
+    write_bgzf(bgzf, ks_str(out), ks_len(out));
+    close_bgzf(bgzf);
+    destroy_kstring(out);
+    return true;
+}
+
+void destroy_index(Index_t* index) {
+    if (index == NULL)
+        return;
+    for (int i = 0; i < kv_size(index -> references); i++) {
+        Reference_t* reference = &kv_A(index -> references, i);
+        for (int j = 0; j < kv_size(reference -> bins); j++)
+            kv_destroy(kv_A(reference -> bins, j).chunks);
+        kv_destroy(reference -> bins);
+        kv_destroy(reference -> linear);
+        free(reference -> name);
+    }
+    kv_destroy(index -> references);
+    free(index);
+}
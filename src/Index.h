@@ -0,0 +1,106 @@
+// File: Index.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Build tabix (.tbi) and CSI indices while BGZF output is written.
+
+#ifndef _INDEX_H_
+#define _INDEX_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "BGZF.h"
+#include "../lib/kvec.h"
+#include "../lib/kstring.h"
+
+// Each linear index window and the smallest bin cover 2^14 bp.
+#define INDEX_MIN_SHIFT 14
+
+// The deepest binning level tabix supports. Larger segments need a CSI index.
+#define TABIX_DEPTH 5
+
+// A run of the file, stored as uncompressed offsets until the index is written.
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} Chunk_t;
+
+// The records of one bin.
+typedef struct {
+    uint32_t bin;
+    kvec_t(Chunk_t) chunks;
+} Bin_t;
+
+// The index of one contig.
+typedef struct {
+    char* name;
+    kvec_t(Bin_t) bins;
+    // The smallest offset of a record overlapping each window.
+    kvec_t(uint64_t) linear;
+    // The first and last offsets of the contig's records, and how many there are.
+    uint64_t start;
+    uint64_t end;
+    uint64_t numRecords;
+} Reference_t;
+
+// A tabix or CSI index. Records must be added in sorted order within each contig.
+typedef struct {
+    // If set, the index is written as CSI instead of tabix.
+    bool csi;
+    // If set, the tabix configuration and contig names are stored in the index.
+    //  Set for VCF and unset for BCF.
+    bool tabixMeta;
+    int depth;
+    kvec_t(Reference_t) references;
+} Index_t;
+
+// Create an empty index. A tabix index is used unless the contigs are too long or csi is set.
+// Accepts:
+//  bool csi -> If set, a CSI index is always used.
+//  bool tabixMeta -> If set, the tabix configuration for VCF is stored in the index.
+//  int64_t maxLength -> The length of the longest contig.
+// Returns: Index_t*, the empty index.
+Index_t* init_index(bool csi, bool tabixMeta, int64_t maxLength);
+
+// Add a contig to the index.
+// Accepts:
+//  Index_t* index -> The index.
+//  const char* name -> The name of the contig.
+// Returns: int, the contig's id.
+int add_index_reference(Index_t* index, const char* name);
+
+// Add a record to the index.
+// Accepts:
+//  Index_t* index -> The index.
+//  int tid -> The contig's id.
+//  int64_t beg -> The 0-based start of the record.
+//  int64_t end -> The 0-based end of the record, exclusive.
+//  uint64_t start -> The uncompressed offset of the first byte of the record.
+//  uint64_t stop -> The uncompressed offset just past the last byte of the record.
+// Returns: void.
+void add_index_record(Index_t* index, int tid, int64_t beg, int64_t end, uint64_t start, uint64_t stop);
+
+// Get the file extension of the index.
+// Accepts:
+//  Index_t* index -> The index.
+// Returns: const char*, ".tbi" or ".csi".
+const char* get_index_extension(Index_t* index);
+
+// Write the index. The data file must have been finished with finish_bgzf.
+// Accepts:
+//  Index_t* index -> The index.
+//  BGZF_t* data -> The indexed file, used to find virtual offsets.
+//  char* fileName -> The name of the index file to create.
+// Returns: bool, true if the index was written.
+bool write_index(Index_t* index, BGZF_t* data, char* fileName);
+
+// Free the index.
+// Accepts:
+//  Index_t* index -> The index.
+// Returns: void.
+void destroy_index(Index_t* index);
+
+#endif
@@ -0,0 +1,356 @@
+// File: Input.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Read ms files line by line, optionally inflating on a read-ahead thread.
+
+// memmem is a GNU extension.
+#define _GNU_SOURCE
+#include "Input.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Finds the first newline in a range of bytes.
+// Accepts:
+//  const char* start -> The first byte.
+//  const char* end -> One past the last byte.
+// Returns: const char*, the newline or NULL if there is none.
+typedef const char* (*FindNewline_t)(const char* start, const char* end);
+
+// The portable scanner.
+static const char* find_newline_scalar(const char* start, const char* end) {
+    return memchr(start, '\n', end - start);
+}
+
+#ifdef __SSE2__
+// Compares sixteen bytes at a time.
+static const char* find_newline_sse2(const char* start, const char* end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; start + 16 <= end; start += 16) {
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) start), newline));
+        if (mask != 0)
+            return start + __builtin_ctz(mask);
+    }
+    return find_newline_scalar(start, end);
+}
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_DISPATCH
+// Compares sixty-four bytes at a time. Only called when the CPU supports AVX2.
+__attribute__((target("avx2"))) static const char* find_newline_avx2(const char* start, const char* end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; start + 64 <= end; start += 64) {
+        uint32_t low = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) start), newline));
+        uint32_t high = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (start + 32)), newline));
+        uint64_t mask = low | (uint64_t) high << 32;
+        if (mask != 0)
+            return start + __builtin_ctzll(mask);
+    }
+    return find_newline_scalar(start, end);
+}
+#endif
+
+// The scanner chosen for this CPU.
+static FindNewline_t find_newline = NULL;
+
+// Picks the widest scanner the CPU supports.
+// Accepts: void.
+// Returns: void.
+static void select_find_newline() {
+    find_newline = find_newline_scalar;
+    #ifdef __SSE2__
+    find_newline = find_newline_sse2;
+    #endif
+    #ifdef HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        find_newline = find_newline_avx2;
+    #endif
+}
+
+// Read bytes from the file itself. Fills buf unless the end of the file is reached.
+// Accepts:
+//  Input_t* input -> The input.
+//  void* buf -> The destination.
+//  int size -> The number of bytes requested.
+// Returns: int, the number of bytes read, 0 at the end of the file, or -1 on error.
+static int read_file(Input_t* input, void* buf, int size) {
+    if (input -> file != NULL)
+        return gzread(input -> file, buf, size);
+    if (input -> inflater != NULL)
+        return read_inflater(input -> inflater, buf, size);
+    int n = 0;
+    while (n < size) {
+        ssize_t count = read(input -> fd, (char*) buf + n, size - n);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            return n > 0 ? n : -1;
+        if (count == 0)
+            break;
+        n += count;
+    }
+    return n;
+}
+
+// Checks whether a file starts with the gzip magic bytes. Only regular files
+//  can be checked without consuming input, so anything else is assumed gzipped
+//  and left to zlib, which passes plain data through.
+// Accepts:
+//  int fd -> The open file.
+// Returns: bool, true if the file should be read through zlib.
+static bool is_gzipped(int fd) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+        return true;
+    unsigned char magic[2];
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    return offset >= 0 && pread(fd, magic, 2, offset) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+// The inflate stage of a read-ahead input. Fills chunks until the end of the file.
+//  An empty chunk is never committed, so the parser sees the end when the ring closes.
+// Accepts:
+//  void* arg -> The Input_t* to read.
+// Returns: void*, NULL.
+static void* read_chunks(void* arg) {
+    Input_t* input = (Input_t*) arg;
+    while (!input -> stop) {
+        kstring_t* chunk = reserve_ring(input -> ring);
+        int n = read_file(input, ks_str(chunk), input -> chunkSize);
+        if (n <= 0)
+            break;
+        chunk -> l = n;
+        commit_ring(input -> ring);
+    }
+    close_ring(input -> ring);
+    return NULL;
+}
+
+// Maps a plain file so its lines can be read in place. Only files that end
+//  in a newline are mapped, so every line ends before the mapping does.
+// Accepts:
+//  Input_t* input -> The input holding the open file.
+// Returns: bool, true if the file was mapped.
+static bool map_input(Input_t* input) {
+    struct stat info;
+    if (fstat(input -> fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+        return false;
+    char last;
+    if (pread(input -> fd, &last, 1, info.st_size - 1) != 1 || last != '\n')
+        return false;
+    void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, input -> fd, 0);
+    if (map == MAP_FAILED)
+        return false;
+    // The file is read once from front to back. Hints are best effort.
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+    #ifdef MADV_HUGEPAGE
+    madvise(map, info.st_size, MADV_HUGEPAGE);
+    #endif
+    input -> buffer = map;
+    input -> capacity = input -> end = info.st_size;
+    input -> eof = true;
+    input -> mapped = true;
+    return true;
+}
+
+Input_t* init_input(char* fileName, int chunkSize, bool readAhead) {
+    // zlib reads a pipe as it arrives, so ms can write to stdin while we parse.
+    int fd = fileName == NULL ? dup(STDIN_FILENO) : open(fileName, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    gzFile file = NULL;
+    if (is_gzipped(fd)) {
+        // zlib gets its own descriptor, so the file stays open if the stream is replaced.
+        file = gzdopen(dup(fd), "r");
+        if (file == NULL) {
+            close(fd);
+            return NULL;
+        }
+        gzbuffer(file, chunkSize);
+    } else {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    Input_t* input = calloc(1, sizeof(Input_t));
+    input -> file = file;
+    input -> fd = fd;
+    input -> chunkSize = chunkSize;
+    if (find_newline == NULL)
+        select_find_newline();
+    if (file == NULL && fileName != NULL && map_input(input))
+        return input;
+    input -> capacity = chunkSize;
+    input -> buffer = malloc(input -> capacity);
+    input -> readAhead = readAhead;
+    return input;
+}
+
+// Read bytes from the input. Fills buf unless the end of the file is reached.
+// Accepts:
+//  Input_t* input -> The input.
+//  void* buf -> The destination.
+//  int size -> The number of bytes requested.
+// Returns: int, the number of bytes read, 0 at the end of the file, or -1 on error.
+static int read_input(Input_t* input, void* buf, int size) {
+    if (!input -> readAhead)
+        return read_file(input, buf, size);
+    if (input -> ring == NULL) {
+        input -> ring = init_ring(INPUT_RING_SIZE, input -> chunkSize);
+        pthread_create(&(input -> reader), NULL, read_chunks, input);
+    }
+    int n = 0;
+    while (n < size) {
+        if (input -> chunk == NULL) {
+            input -> chunk = peek_ring(input -> ring);
+            input -> offset = 0;
+            if (input -> chunk == NULL)
+                break;
+        }
+        size_t available = ks_len(input -> chunk) - input -> offset;
+        size_t count = available < (size_t) (size - n) ? available : (size_t) (size - n);
+        memcpy((char*) buf + n, ks_str(input -> chunk) + input -> offset, count);
+        input -> offset += count;
+        n += count;
+        if (input -> offset == ks_len(input -> chunk)) {
+            release_ring(input -> ring);
+            input -> chunk = NULL;
+        }
+    }
+    return n;
+}
+
+// Classifies a line by its leading token.
+// Accepts:
+//  const char* text -> The line.
+//  int length -> The length of the line.
+// Returns: LineType_t, the kind of line.
+static LineType_t classify_line(const char* text, int length) {
+    if (length == 0)
+        return LINE_EMPTY;
+    if (text[0] == 's' && length >= 9 && memcmp(text, "segsites:", 9) == 0)
+        return LINE_SEGSITES;
+    if (text[0] == 'p' && length >= 10 && memcmp(text, "positions:", 10) == 0)
+        return LINE_POSITIONS;
+    return LINE_DATA;
+}
+
+bool seek_input(Input_t* input, SeekIndex_t* index, uint64_t offset) {
+    if (input -> mapped) {
+        if (offset > input -> end)
+            return false;
+        input -> start = input -> scan = offset;
+        return true;
+    }
+    if (input -> file == NULL)
+        return !index -> gzipped && lseek(input -> fd, offset, SEEK_SET) >= 0;
+    if (!index -> gzipped)
+        return false;
+    Inflater_t* inflater = init_inflater(input -> fd, index, offset);
+    if (inflater == NULL)
+        return false;
+    gzclose(input -> file);
+    input -> file = NULL;
+    input -> inflater = inflater;
+    return true;
+}
+
+// Reads more of the file into the buffer. Lines already returned are dropped,
+//  and the buffer grows if a single line fills it.
+// Accepts:
+//  Input_t* input -> The input.
+// Returns: void. Sets eof at the end of the file.
+static void fill_buffer(Input_t* input) {
+    if (input -> start > 0) {
+        memmove(input -> buffer, input -> buffer + input -> start, input -> end - input -> start);
+        input -> end -= input -> start;
+        input -> scan -= input -> start;
+        input -> start = 0;
+    }
+    if (input -> end + 1 >= input -> capacity) {
+        input -> capacity *= 2;
+        input -> buffer = realloc(input -> buffer, input -> capacity);
+    }
+    size_t room = input -> capacity - input -> end - 1;
+    int n = read_input(input, input -> buffer + input -> end, room < (size_t) input -> chunkSize ? room : (size_t) input -> chunkSize);
+    if (n <= 0)
+        input -> eof = true;
+    else
+        input -> end += n;
+}
+
+bool read_line(Input_t* input, Line_t* line) {
+    while (true) {
+        const char* newline = find_newline(input -> buffer + input -> scan, input -> buffer + input -> end);
+        size_t stop = newline == NULL ? input -> end : (size_t) (newline - input -> buffer);
+        // The last line of a file may not end in a newline. There is always room for its terminator.
+        if (newline != NULL || (input -> eof && input -> start < input -> end)) {
+            line -> text = input -> buffer + input -> start;
+            line -> length = stop - input -> start;
+            if (!input -> mapped)
+                line -> text[line -> length] = '\0';
+            line -> type = classify_line(line -> text, line -> length);
+            input -> start = input -> scan = newline == NULL ? stop : stop + 1;
+            return true;
+        }
+        input -> scan = stop;
+        if (input -> eof) {
+            line -> text = NULL;
+            line -> length = 0;
+            line -> type = LINE_END;
+            return false;
+        }
+        fill_buffer(input);
+    }
+}
+
+bool skip_to_segsites(Input_t* input, Line_t* line) {
+    // The marker is found with a single substring search per buffer, so the
+    //  lines of skipped replicates are never split or classified.
+    static const char MARKER[] = "\nsegsites:";
+    const size_t markerLength = sizeof(MARKER) - 1;
+    // Bytes at start begin a line, so a marker there has no newline before it.
+    if (input -> end - input -> start >= markerLength - 1 && memcmp(input -> buffer + input -> start, MARKER + 1, markerLength - 1) == 0)
+        return read_line(input, line);
+    while (true) {
+        const char* marker = memmem(input -> buffer + input -> start, input -> end - input -> start, MARKER, markerLength);
+        if (marker != NULL) {
+            input -> start = input -> scan = marker + 1 - input -> buffer;
+            return read_line(input, line);
+        }
+        // Keep only what could be the start of a marker split across reads.
+        if (input -> end - input -> start >= markerLength)
+            input -> start = input -> scan = input -> end - (markerLength - 1);
+        if (input -> eof) {
+            input -> start = input -> scan = input -> end;
+            return read_line(input, line);
+        }
+        fill_buffer(input);
+    }
+}
+
+void destroy_input(Input_t* input) {
+    if (input == NULL)
+        return;
+    if (input -> ring != NULL) {
+        // Drain the ring so the read-ahead thread can see it should stop.
+        input -> stop = true;
+        if (input -> chunk != NULL)
+            release_ring(input -> ring);
+        while (peek_ring(input -> ring) != NULL)
+            release_ring(input -> ring);
+        pthread_join(input -> reader, NULL);
+        destroy_ring(input -> ring);
+    }
+    if (input -> file != NULL)
+        gzclose(input -> file);
+    destroy_inflater(input -> inflater);
+    close(input -> fd);
+    if (input -> mapped)
+        munmap(input -> buffer, input -> capacity);
+    else
+        free(input -> buffer);
+    free(input);
+}
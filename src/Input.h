@@ -0,0 +1,118 @@
+// File: Input.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Read ms files line by line, optionally inflating on a read-ahead thread.
+
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include "Ring.h"
+#include "Seek.h"
+#include "../lib/zlib.h"
+#include "../lib/kstring.h"
+
+// The default number of bytes read at once, and inflated into each slot by the read-ahead thread.
+#define INPUT_BUFFER_SIZE 1048576
+
+// The number of inflated chunks that can wait for the parser.
+#define INPUT_RING_SIZE 4
+
+// The kinds of lines in ms output.
+typedef enum {
+    // Past the last line.
+    LINE_END,
+    LINE_EMPTY,
+    LINE_SEGSITES,
+    LINE_POSITIONS,
+    // Anything else: haplotypes, the command line, seeds, and "//".
+    LINE_DATA
+} LineType_t;
+
+// A line of the input. The text points into the input's buffer and ends at
+//  a newline or a terminator. It is valid until the next line is read, or
+//  until the input is destroyed if the input is mapped.
+typedef struct {
+    char* text;
+    int length;
+    LineType_t type;
+} Line_t;
+
+// An open ms file. A plain file is mapped into memory and its lines are
+//  read in place. Otherwise, with read-ahead, a separate thread inflates chunks
+//  into a ring while the parser consumes the previous ones.
+typedef struct {
+    // The gzipped stream, or NULL if a plain file is read directly from fd.
+    gzFile file;
+    int fd;
+    // Replaces the gzipped stream once the input has been moved to a replicate.
+    Inflater_t* inflater;
+    // The number of bytes in each chunk.
+    int chunkSize;
+    // The ring from the read-ahead thread, or NULL if the parser reads the file directly.
+    //  The thread is started by the first read.
+    bool readAhead;
+    Ring_t* ring;
+    pthread_t reader;
+    // Set to stop the read-ahead thread before the end of the file.
+    _Atomic bool stop;
+    // The chunk being consumed and the read offset within it.
+    kstring_t* chunk;
+    size_t offset;
+    // Lines are found in place within the buffer. Bytes before start have been
+    //  returned, and bytes before scan hold no newline.
+    char* buffer;
+    size_t capacity, start, scan, end;
+    bool eof;
+    // If set, the buffer is the mapped file.
+    bool mapped;
+} Input_t;
+
+// Open an ms file. Both plain and gzipped files are accepted. Plain files
+//  are mapped, or read with read() if they cannot be, so zlib is skipped entirely.
+// Accepts:
+//  char* fileName -> The name of the file, or NULL to read from stdin.
+//  int chunkSize -> The number of bytes read at once, and the starting size of the line buffer.
+//  bool readAhead -> If set, the file is read and inflated on a separate thread.
+// Returns: Input_t*, the opened input or NULL if the file could not be opened.
+Input_t* init_input(char* fileName, int chunkSize, bool readAhead);
+
+// Move the input to an uncompressed offset. Must be called before the first line is read.
+// Accepts:
+//  Input_t* input -> The input.
+//  SeekIndex_t* index -> The sidecar of the file.
+//  uint64_t offset -> The offset of the next line to read.
+// Returns: bool, true if the input was moved.
+bool seek_input(Input_t* input, SeekIndex_t* index, uint64_t offset);
+
+// Read the next line of the input without copying it.
+// Accepts:
+//  Input_t* input -> The input.
+//  Line_t* line -> Set to the line. Its type is LINE_END past the last line.
+// Returns: bool, false past the last line.
+bool read_line(Input_t* input, Line_t* line);
+
+// Skip to the next "segsites:" line without splitting the lines before it.
+//  Used to pass over replicates that are not converted.
+// Accepts:
+//  Input_t* input -> The input.
+//  Line_t* line -> Set to the "segsites:" line. Its type is LINE_END if there is none.
+// Returns: bool, false if there is no "segsites:" line left.
+bool skip_to_segsites(Input_t* input, Line_t* line);
+
+// Stop the read-ahead thread, close the file, and free the input.
+// Accepts:
+//  Input_t* input -> The input.
+// Returns: void.
+void destroy_input(Input_t* input);
+
+#endif
@@ -9,135 +9,73 @@
 #include <stdlib.h>
 #include <time.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <ctype.h>
+#include <errno.h>
 #include <math.h>
 #include "../lib/ketopt.h"
 #include "../lib/zlib.h"
 #include "../lib/kstring.h"
-#include "../lib/kseq.h"
 #include "../lib/kvec.h"
-
-// We use kseq to read in from stdin.
-#define BUFFER_SIZE 4096
-KSTREAM_INIT(gzFile, gzread, BUFFER_SIZE)
-
-// We want random floats between [0, 1).
-#define rand() ((float) rand() / (float) (RAND_MAX))
-
-// Prints ms replicate to VCF file.
+#include "Input.h"
+#include "Queue.h"
+#include "Replicate.h"
+#include "Positions.h"
+#include "VCF.h"
+
+// The shared state of the conversion threads.
+typedef struct {
+    VCFConfig_t* config;
+    // Parsed replicates waiting to be converted.
+    Queue_t* filled;
+    // Converted replicates that can be reused by the reader.
+    Queue_t* empty;
+} Pool_t;
+
+// A run of replicates to convert: first, first + step, and so on up to last.
+typedef struct {
+    int first;
+    int last;
+    int step;
+} ReplicateRange_t;
+
+// The replicates to convert. If empty, every replicate is converted.
+typedef kvec_t(ReplicateRange_t) Selection_t;
+
+// Converts replicates handed over by the reader until it is done.
 // Accepts:
-//  char* fileName -> The name of the input file.
-//  int length -> The length of the segment in bp.
-//  bool unphased -> If set, the resulting output should be unphased.
-//  bool compress -> If set, the resulting files should be compressed.
-//  int numReplicate -> The current replicate number.
-//  int numSegsites -> The number of segregating sites in the replicate.
-//  int numSamples -> The number of samples in the replicate.
-//  kvec_t(double) positions -> The list of segregating site positions.
-//  kvec_t(kstring_t*) samples -> The list of simulated samples.
-// Returns: void.
-void toVCF(char* fileName, int length, bool unphased, double missing, bool compress, int numReplicate, int numSegsites, int numSamples, kvec_t(double)* positions, kvec_t(kstring_t*)* samples) {
-    // Create the output base name.
-    kstring_t* outputBase = calloc(1, sizeof(kstring_t));
-    if (strncmp(fileName + strlen(fileName) - 3, ".ms", 3) == 0) {
-        kputsn(fileName, strlen(fileName) - 3, outputBase);
-    }
-    if (strncmp(fileName + strlen(fileName) - 6, ".ms.gz", 6) == 0) {
-        kputsn(fileName, strlen(fileName) - 6, outputBase);
+//  void* arg -> The Pool_t* shared by the threads.
+// Returns: void*, NULL.
+void* convert_replicates(void* arg) {
+    Pool_t* pool = (Pool_t*) arg;
+    Replicate_t* replicate;
+    while ((replicate = pop_queue(pool -> filled)) != NULL) {
+        toVCF(pool -> config, replicate);
+        push_queue(pool -> empty, replicate);
     }
-
-    // I am repeating identical code here for fprintf/gzprint. I could have avoided this with a macro.
-
-    // Write to the file
-    int prevPosition = 0, pos;
-    char leftGeno, rightGeno, temp;
-    if (!compress) {
-        // Create the output file name.
-        char outputFileName[strlen(outputBase -> s) + ((int) log10(numReplicate + 1.0) + 1) + 9];
-        sprintf(outputFileName, "%s_rep%d.vcf\0", outputBase -> s, numReplicate);
-        FILE* fp = fopen(outputFileName, "w");
-        // Print VCF header.
-        fprintf(fp, "##fileformat=VCFv4.2\n");
-        fprintf(fp, "##contig=<ID=chr1,length=%d>\n", length);
-        fprintf(fp, "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT");
-        // Print sample names in the header.
-        for (int i = 0; i < numSamples / 2; i++) {
-            fprintf(fp, "\ts%d", i);
-        } 
-        fprintf(fp, "\n");
-        // Process each record.
-        for (int i = 0; i < numSegsites; i++) {
-            pos = (int) (kv_A(*positions, i) * length);
-            // Make sure the positions are unique.
-            if (pos == prevPosition) { pos += 1; }
-            prevPosition = pos;
-            fprintf(fp, "chr1\t%d\t.\tA\tT\t.\t.\t.\t.", pos);
-            for (int j = 0; j < numSamples / 2; j++) {
-                leftGeno = kv_A(*samples, 2 * j) -> s[i];
-                rightGeno = kv_A(*samples, 2 * j + 1) -> s[i];
-                // If unphased, swap genotypes with 50% probability.
-                if (unphased) {
-                    if (rand() < 0.5) { temp = leftGeno; leftGeno = rightGeno; rightGeno = leftGeno; }
-                    // If missing probability is set, sprinkle missing genotypes.
-                    if (missing > 0) {
-                        if (rand() < missing) fprintf(fp, "\t."); else fprintf(fp, "\t%c", leftGeno);
-                        if (rand() < missing) fprintf(fp, "/."); else fprintf(fp, "/%c", rightGeno);
-                    } else { fprintf(fp, "\t%c/%c", leftGeno, rightGeno); }
-                } else {
-                    if (missing > 0) {
-                        if (rand() < missing) fprintf(fp, "\t."); else fprintf(fp, "\t%c", leftGeno);
-                        if (rand() < missing) fprintf(fp, "|."); else fprintf(fp, "|%c", rightGeno);
-                    } else { fprintf(fp, "\t%c|%c", leftGeno, rightGeno); }
-                }
-            }
-            fprintf(fp, "\n");
-        }
-        fclose(fp);
-    } else {
-        char outputFileName[strlen(outputBase -> s) + ((int) log10(numReplicate + 1.0) + 1) + 12];
-        sprintf(outputFileName, "%s_rep%d.vcf.gz\0", outputBase -> s, numReplicate);
-        gzFile fp = gzopen(outputFileName, "w");
-        gzprintf(fp, "##fileformat=VCFv4.2\n");
-        gzprintf(fp, "##contig=<ID=chr1,length=%d>\n", length);
-        gzprintf(fp, "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT");
-        for (int i = 0; i < numSamples / 2; i++) {
-            gzprintf(fp, "\ts%d", i);
-        } 
-        gzprintf(fp, "\n");
-        for (int i = 0; i < numSegsites; i++) {
-            pos = (int) (kv_A(*positions, i) * length);
-            if (pos == prevPosition) { pos += 1; }
-            prevPosition = pos;
-            gzprintf(fp, "chr1\t%d\t.\tA\tT\t.\t.\t.\t.", pos);
-            for (int j = 0; j < numSamples / 2; j++) {
-                leftGeno = kv_A(*samples, 2 * j) -> s[i];
-                rightGeno = kv_A(*samples, 2 * j + 1) -> s[i];
-                if (unphased) {
-                    if (rand() < 0.5) { temp = leftGeno; leftGeno = rightGeno; rightGeno = leftGeno; }
-                    if (missing > 0) {
-                        if (rand() < missing) gzprintf(fp, "\t."); else gzprintf(fp, "\t%c", leftGeno);
-                        if (rand() < missing) gzprintf(fp, "/."); else gzprintf(fp, "/%c", rightGeno);
-                    } else { gzprintf(fp, "\t%c/%c", leftGeno, rightGeno); }
-                } else {
-                    if (missing > 0) {
-                        if (rand() < missing) gzprintf(fp, "\t."); else gzprintf(fp, "\t%c", leftGeno);
-                        if (rand() < missing) gzprintf(fp, "|."); else gzprintf(fp, "|%c", rightGeno);
-                    } else { gzprintf(fp, "\t%c|%c", leftGeno, rightGeno); }
-                }
-            }
-            gzprintf(fp, "\n");
-        }
-        gzclose(fp);
-    }
-    free(outputBase -> s); free(outputBase);
+    return NULL;
 }
 
 // Checks that user supplied options are valid.
 // Accepts:
 //  int length -> The user supplied length.
 //  double missing -> The user supplied missing genotype probability.
+//  int threads -> The user supplied number of threads.
+//  char outputType -> The user supplied output type.
+//  bool index -> The user supplied index flag.
+//  int bufferMiB -> The user supplied input buffer size in MiB.
+//  bool validSelection -> Set if the user supplied list of replicates could be parsed.
+//  bool validSeed -> Set if the user supplied seed could be parsed.
+//  bool single -> The user supplied single output flag.
+//  int perFile -> The user supplied number of replicates per file, or 0.
+//  char* outputPrefix -> The user supplied output prefix, or NULL.
+//  int level -> The user supplied compression level, or -1 for the default of the output type.
+//  int strategy -> The user supplied compression strategy, -1 if unknown, or -2 if not given.
+//  double targetMBps -> The user supplied auto-tune target, or 0.
+//  bool longMatching -> The user supplied long distance matching flag.
 // Returns:
 //  int, 0 or 1, for valid user supplied options or invalid options, respectively.
-int check_configuration(int length, double missing) {
+int check_configuration(int length, double missing, int threads, char outputType, bool index, int bufferMiB, bool validSelection, bool validSeed, bool single, int perFile, char* outputPrefix, int level, int strategy, double targetMBps, bool longMatching) {
     if (length < 1000) {
         printf("Error! Length must be 1000 or greater to avoid multiple records at the same locus.\n");
         return 1;
@@ -146,9 +84,174 @@ int check_configuration(int length, double missing) {
         printf("Error! The probability of a missing genotype must be in [0, 1).\n");
         return 1;
     }
+    if (threads < 1) {
+        printf("Error! The number of threads must be 1 or greater.\n");
+        return 1;
+    }
+    if (outputType != 'v' && outputType != 'z' && outputType != 'b' && outputType != 's') {
+        printf("Error! The output type must be v, z, b, or s.\n");
+        return 1;
+    }
+    #ifndef HAVE_ZSTD
+    if (outputType == 's') {
+        printf("Error! This msToVCF was built without zstd. Rebuild with make ZSTD=1 to use -O s.\n");
+        return 1;
+    }
+    #endif
+    if (index && (outputType == 'v' || outputType == 's')) {
+        printf("Error! Only BGZF files can be indexed. Use -c, -O z, or -O b with --index.\n");
+        return 1;
+    }
+    if (bufferMiB < 1 || bufferMiB > 1024) {
+        printf("Error! The input buffer size must be between 1 and 1024 MiB.\n");
+        return 1;
+    }
+    if (!validSelection) {
+        printf("Error! Replicates must be a comma separated list of A, A-B, A-, A-B:STEP, or A-:STEP with 0 <= A <= B and STEP >= 1.\n");
+        return 1;
+    }
+    if (!validSeed) {
+        printf("Error! The seed must be a whole number from 0 to 18446744073709551615.\n");
+        return 1;
+    }
+    if (perFile < 0 || (perFile > 0 && single)) {
+        printf("Error! The number of replicates per file must be 1 or greater, and cannot be combined with --single.\n");
+        return 1;
+    }
+    if (perFile > 0 && outputPrefix != NULL && strcmp(outputPrefix, "-") == 0) {
+        printf("Error! Files of replicates cannot be written to stdout. Use --single with -o -.\n");
+        return 1;
+    }
+    if (outputType == 's' && level != -1 && (level < 1 || level > 19)) {
+        printf("Error! The zstd compression level must be between 1 and 19.\n");
+        return 1;
+    }
+    if (outputType != 's' && level != -1 && (level < 0 || level > 9)) {
+        printf("Error! The compression level must be between 0 and 9.\n");
+        return 1;
+    }
+    if (longMatching && outputType != 's') {
+        printf("Error! Long distance matching is a zstd option. Use -O s with --long.\n");
+        return 1;
+    }
+    if (strategy == -1) {
+        printf("Error! The compression strategy must be default, filtered, huffman, rle, or fixed.\n");
+        return 1;
+    }
+    if (strategy != -2 && outputType == 's') {
+        printf("Error! The compression strategy is a zlib option and has no effect on zstd. Use -c, -O z, or -O b with --strategy.\n");
+        return 1;
+    }
+    if (targetMBps > 0 && outputType == 's') {
+        printf("Error! Auto-tune picks a zlib level and strategy. Use -c, -O z, or -O b with --auto-tune.\n");
+        return 1;
+    }
+    if (targetMBps < 0 || (targetMBps > 0 && outputType == 'v')) {
+        printf("Error! Auto-tune needs a positive rate in MB/s and compressed output. Use -c, -O z, or -O b with --auto-tune.\n");
+        return 1;
+    }
+    if (targetMBps > 0 && (level != -1 || strategy != -2)) {
+        printf("Error! Auto-tune picks the level and strategy itself. Drop --level and --strategy to use --auto-tune.\n");
+        return 1;
+    }
+    if (index && single && outputPrefix != NULL && strcmp(outputPrefix, "-") == 0) {
+        printf("Error! Standard output cannot be indexed. Give --single a file prefix with -o to use --index.\n");
+        return 1;
+    }
     return 0;
 }
 
+// Parses a seed. The whole argument must be an unsigned decimal number that fits in 64 bits.
+// Accepts:
+//  const char* text -> The user supplied seed.
+//  uint64_t* seed -> Set to the seed if it is valid.
+// Returns: bool, true if the seed is valid.
+bool parse_seed(const char* text, uint64_t* seed) {
+    // strtoull accepts a sign and leading spaces, so require a digit first.
+    if (!isdigit((unsigned char) text[0]))
+        return false;
+    char* end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0')
+        return false;
+    *seed = value;
+    return true;
+}
+
+// Parses a list of replicates such as 0-9,20,30-100:10. Each item is A, A-B, or A-,
+//  optionally followed by :STEP to take every STEP-th replicate of the range.
+// Accepts:
+//  const char* list -> The user supplied list.
+//  Selection_t* selection -> The ranges are appended to the selection.
+// Returns: bool, true if the list is valid.
+bool parse_selection(const char* list, Selection_t* selection) {
+    const char* p = list;
+    while (true) {
+        char* end;
+        ReplicateRange_t range;
+        range.first = strtol(p, &end, 10);
+        if (end == p || range.first < 0)
+            return false;
+        range.last = range.first;
+        range.step = 1;
+        p = end;
+        if (*p == '-') {
+            p++;
+            range.last = strtol(p, &end, 10);
+            if (end == p)
+                range.last = INT_MAX;
+            p = end;
+        }
+        if (*p == ':') {
+            p++;
+            range.step = strtol(p, &end, 10);
+            if (end == p)
+                return false;
+            p = end;
+        }
+        if (range.last < range.first || range.step < 1)
+            return false;
+        kv_push(ReplicateRange_t, *selection, range);
+        if (*p == '\0')
+            return true;
+        if (*p++ != ',')
+            return false;
+    }
+}
+
+// Checks whether a replicate should be converted.
+// Accepts:
+//  Selection_t* selection -> The selected replicates.
+//  int numReplicate -> The replicate.
+// Returns: bool, true if the replicate is selected.
+bool is_selected(Selection_t* selection, int numReplicate) {
+    if (kv_size(*selection) == 0)
+        return true;
+    for (int i = 0; i < kv_size(*selection); i++) {
+        ReplicateRange_t* range = &kv_A(*selection, i);
+        if (numReplicate >= range -> first && numReplicate <= range -> last && (numReplicate - range -> first) % range -> step == 0)
+            return true;
+    }
+    return false;
+}
+
+// Gets the number of replicates from the command line that ms prints first, "ms nsam howmany ...".
+// Accepts:
+//  const char* text -> The line, terminated after length characters.
+//  int length -> The length of the line.
+// Returns: int, the number of replicates, or 0 if the line does not hold one.
+int count_replicates(const char* text, int length) {
+    kstring_t* commandLine = init_kstring(NULL);
+    kputsn(text, length, commandLine);
+    // The program name tells the command line apart from the seeds that follow it.
+    int numSamples, numReplicates;
+    if (length == 0 || isdigit((unsigned char) text[0]) || sscanf(ks_str(commandLine), "%*s %d %d", &numSamples, &numReplicates) != 2 || numSamples < 1 || numReplicates < 1)
+        numReplicates = 0;
+    destroy_kstring(commandLine);
+    return numReplicates;
+}
+
 // Print the help menu for msToVCF.
 // Accepts: void.
 // Returns: void.
@@ -160,15 +263,58 @@ void print_help() {
     printf("Principal Investigator: Zachary A. Szpiech\n");
     printf("The Pennsylvania State University\n\n");
     printf("Usage: msToVCF [options] <inFile.ms.gz>\n");
+    printf("       ms ... | msToVCF [options] -o PREFIX -\n");
     printf("Options:\n");
+    printf("   -o STR           Prefix of the output files. Required when reading from stdin.\n");
+    printf("                       Default is the input file name without .ms or .ms.gz.\n");
     printf("   -l INT           Sets length of segment in number of base pairs. Default 1,000,000.\n");
     printf("   -u               If set, the phase is removed from genotypes.\n");
     printf("   -m DOUBLE        Genotypes are missing with supplied probability. Default 0.\n");
-    printf("   -c               If set, the resulting files are gzipped compressed.\n");
+    printf("   --seed INT       Seed for -u and -m. The same seed gives the same output. Default is the time,\n");
+    printf("                       which is printed to stderr when -u or -m is used.\n");
+    printf("   -c               If set, the resulting files are BGZF compressed. Same as -O z.\n");
+    printf("   -O v|z|b|s       Output type: v for VCF, z for BGZF compressed VCF, b for BCF, s for seekable\n");
+    printf("                       zstd compressed VCF (.vcf.zst), if built with make ZSTD=1. Default v.\n");
+    printf("   --level INT      Compression level from 0 to 9, or 1 to 19 with -O s. Default 6, or 3 with -O s.\n");
+    printf("   --strategy STR   BGZF compression strategy: default, filtered, huffman, rle, or fixed. Default default.\n");
+    printf("   --long           With -O s, match across 16 MiB frames instead of 1 MiB ones. Smaller, slower output.\n");
+    printf("   --auto-tune DOUBLE\n");
+    printf("                    Pick the BGZF level and strategy by compressing a sample of the first replicate. The smallest\n");
+    printf("                       output compressed at DOUBLE MB/s or more across the threads wins, else the fastest.\n");
+    printf("                       Cannot be combined with --level or --strategy.\n");
+    printf("   -p               If set, haplotypes are stored with one bit per site to save memory.\n");
+    printf("   -t INT           Number of threads used to convert replicates. Default 1.\n");
+    printf("                       With more than one, input and output compression also run on their own threads\n");
+    printf("                       and BGZF blocks or zstd frames are compressed in parallel.\n");
+    printf("   --index          If set, a tabix index (CSI for BCF) is written next to each compressed file.\n");
+    printf("   --buffer INT     Size of the input buffer in MiB. Default 1.\n");
+    printf("   --build-index    Write a sidecar (inFile.msi) of replicate offsets and gzip access points, then exit.\n");
+    printf("   --replicates LIST\n");
+    printf("                    Only convert the listed replicates, counting from 0. LIST is comma separated\n");
+    printf("                       A, A-B, or A-, each optionally with :STEP, such as 0-9,20,30-100:10.\n");
+    printf("                       With a sidecar, the input is read from the first listed replicate.\n");
+    printf("   --single         Write every replicate to one file, PREFIX.vcf, .vcf.gz, .vcf.zst, or .bcf, with replicate N\n");
+    printf("                       as contig repN. With -o -, the file is written to stdout.\n");
+    printf("   --replicates-per-file INT\n");
+    printf("                    Write INT replicates to each file. Shard S holds replicates S * INT onwards in\n");
+    printf("                       PREFIX_shards/D/shardS.vcf, .vcf.gz, .vcf.zst, or .bcf, with %d shards per directory D.\n", SHARDS_PER_DIRECTORY);
+    printf("                       Replicate N is contig repN, and shardS.*.manifest lists where its records lie.\n");
     printf("\n");
 }
 
+// Long options without a single character alias use values past the ASCII range.
 static ko_longopt_t long_options[] = {
+    {"index", ko_no_argument, 300},
+    {"seed", ko_required_argument, 301},
+    {"buffer", ko_required_argument, 302},
+    {"build-index", ko_no_argument, 303},
+    {"replicates", ko_required_argument, 304},
+    {"single", ko_no_argument, 305},
+    {"replicates-per-file", ko_required_argument, 306},
+    {"level", ko_required_argument, 307},
+    {"strategy", ko_required_argument, 308},
+    {"auto-tune", ko_required_argument, 309},
+    {"long", ko_no_argument, 310},
     {NULL, 0, 0}
 };
 
@@ -188,123 +334,281 @@ int main(int argc, char *argv[]) {
     int length = 1000000;
     bool unphased = false;
     double missing = 0;
-    bool compress = false;
-
-    while ((c = ketopt(&options, argc, argv, 1, "l:um:c", long_options)) >= 0) {
-		if (c == 'l') length = atoi(options.arg);
+    char outputType = 'v';
+    bool packed = false;
+    int threads = 1;
+    bool index = false;
+    char* outputPrefix = NULL;
+    int bufferMiB = INPUT_BUFFER_SIZE >> 20;
+    bool buildIndex = false;
+    Selection_t selection;
+    kv_init(selection);
+    bool validSelection = true;
+    bool single = false;
+    int perFile = 0;
+    // Resolved to the defaults once the options are checked.
+    int level = -1;
+    int strategy = -2;
+    double targetMBps = 0;
+    bool longMatching = false;
+    // Unless a seed is given, use the time.
+    uint64_t seed = time(NULL);
+    bool seedGiven = false, validSeed = true;
+
+    while ((c = ketopt(&options, argc, argv, 1, "o:l:um:cO:pt:", long_options)) >= 0) {
+		if (c == 'o') outputPrefix = options.arg;
+		else if (c == 'l') length = atoi(options.arg);
 		else if (c == 'u') unphased = true;
 		else if (c == 'm') missing = atof(options.arg);
-        else if (c == 'c') compress = true;
+        else if (c == 'c') outputType = 'z';
+        // Anything but a single character is not a type, so check_configuration rejects it.
+        else if (c == 'O') outputType = strlen(options.arg) == 1 ? options.arg[0] : '?';
+        else if (c == 'p') packed = true;
+        else if (c == 't') threads = atoi(options.arg);
+        else if (c == 300) index = true;
+        else if (c == 301) { validSeed = parse_seed(options.arg, &seed); seedGiven = true; }
+        else if (c == 302) bufferMiB = atoi(options.arg);
+        else if (c == 303) buildIndex = true;
+        else if (c == 304) validSelection = parse_selection(options.arg, &selection);
+        else if (c == 305) single = true;
+        else if (c == 306) perFile = atoi(options.arg);
+        else if (c == 307) level = atoi(options.arg);
+        else if (c == 308) strategy = parse_strategy(options.arg);
+        else if (c == 309) targetMBps = atof(options.arg);
+        else if (c == 310) longMatching = true;
         else { printf("Unknow option %s. Exiting!\n", argv[options.i]); return 1;}
 	}
 
     // Get file name.
+    if (options.ind >= argc) {
+        printf("No input file given. Exiting!\n");
+        return 1;
+    }
     char* fileName = argv[options.ind];
-
-    // Seed random number generator.
-    srand(time(NULL));
+    bool fromStdin = strcmp(fileName, "-") == 0 || strcmp(fileName, "/dev/stdin") == 0;
 
     // Check configuration. If invalid argument, exit program.
-    if (check_configuration(length, missing) != 0) {
+    if (check_configuration(length, missing, threads, outputType, index, bufferMiB, validSelection, validSeed, single, perFile, outputPrefix, level, strategy, targetMBps, longMatching) != 0) {
         printf("Exiting!\n");
         return 1;
     }
 
+    // A seed taken from the time is reported so the run can be reproduced.
+    //  It goes to stderr since the records may be on stdout.
+    if (!seedGiven && (unphased || missing > 0))
+        fprintf(stderr, "Using seed %llu. Pass --seed %llu to reproduce this run.\n", (unsigned long long) seed, (unsigned long long) seed);
+
+    // The span of the selected replicates.
+    int firstReplicate = kv_size(selection) == 0 ? 0 : INT_MAX, lastReplicate = kv_size(selection) == 0 ? INT_MAX : 0;
+    for (int i = 0; i < kv_size(selection); i++) {
+        if (kv_A(selection, i).first < firstReplicate)
+            firstReplicate = kv_A(selection, i).first;
+        if (kv_A(selection, i).last > lastReplicate)
+            lastReplicate = kv_A(selection, i).last;
+    }
+
+    // The sidecar of an ms file lets later runs start at any replicate.
+    kstring_t* sidecar = init_kstring(fileName);
+    kputs(SEEK_EXTENSION, sidecar);
+    if (buildIndex) {
+        SeekIndex_t* seekIndex = fromStdin ? NULL : build_seek_index(fileName, SEEK_SPAN);
+        if (seekIndex == NULL || !write_seek_index(seekIndex, ks_str(sidecar))) {
+            printf("Could not index %s. Exiting!\n", fileName);
+            destroy_seek_index(seekIndex);
+            destroy_kstring(sidecar);
+            return 1;
+        }
+        printf("Indexed %d replicates with %d access points in %s.\n", (int) kv_size(seekIndex -> replicates), (int) kv_size(seekIndex -> points), ks_str(sidecar));
+        destroy_seek_index(seekIndex);
+        destroy_kstring(sidecar);
+        return 0;
+    }
+
+    // Output names come from the input file unless a prefix is given, so stdin needs one.
+    if (fromStdin && outputPrefix == NULL) {
+        printf("Reading from stdin requires an output prefix. Use -o PREFIX. Exiting!\n");
+        return 1;
+    }
+
     // If the file does not have .ms or .ms.gz extension.
-    if (strncmp(fileName + strlen(fileName) - 3, ".ms", 3) != 0 && strncmp(fileName + strlen(fileName) - 6, ".ms.gz", 6)) {
+    if (outputPrefix == NULL && strncmp(fileName + strlen(fileName) - 3, ".ms", 3) != 0 && strncmp(fileName + strlen(fileName) - 6, ".ms.gz", 6)) {
         printf("File does not have .ms or .ms.gz extension. Exiting!\n");
         return 1;
     }
 
-    // Open the input file.
-    gzFile file = gzopen(fileName, "r");
-    // If file does not exist or is not compressed using gzip, return NULL.
-    int errnum;
-    gzerror(file, &errnum);
-    if (errnum != Z_OK) {
+    // Open the input file. With more than one thread, the file is inflated on its own thread.
+    Input_t* file = init_input(fromStdin ? NULL : fileName, bufferMiB << 20, threads > 1);
+    if (file == NULL) {
         printf("File does not exist. Exiting!\n");
+        destroy_kstring(sidecar);
         return 1;
     }
-    kstream_t* stream = ks_init(file);
-    kstring_t* buffer = init_kstring(NULL);
 
-    // Initalize memory used to read in a replicate.
-    kvec_t(double) positions;
-	kv_init(positions);
-    kvec_t(kstring_t*) samples;
-    kv_init(samples);
+    // With a sidecar, jump straight to the first requested replicate.
+    //  The sidecar also counts the replicates, which a stream declares as contigs.
+    int numReplicate = 0, numReplicates = 0;
+    if ((firstReplicate > 0 || single || perFile > 0) && !fromStdin) {
+        SeekIndex_t* seekIndex = read_seek_index(ks_str(sidecar), file -> fd);
+        if (seekIndex != NULL && kv_size(seekIndex -> replicates) > 0) {
+            numReplicates = kv_size(seekIndex -> replicates);
+            int target = firstReplicate < numReplicates ? firstReplicate : numReplicates - 1;
+            if (firstReplicate > 0 && seek_input(file, seekIndex, kv_A(seekIndex -> replicates, target)))
+                numReplicate = target;
+        }
+        destroy_seek_index(seekIndex);
+    }
+    destroy_kstring(sidecar);
+
+    // Eat lines until "segsites:" is encountered. Unless the input was
+    //  repositioned, the first line is the ms command line.
+    Line_t line;
+    bool firstLine = numReplicates == 0;
+    while (read_line(file, &line) && line.type != LINE_SEGSITES) {
+        if (firstLine && line.type == LINE_DATA)
+            numReplicates = count_replicates(line.text, line.length);
+        firstLine = false;
+    }
 
-    // Eat lines until "segsites:" is encountered.
-    do {
-        ks_getuntil(stream, '\n', buffer, 0);
-    } while (strncmp(ks_str(buffer), "segsites:", 9) != 0);
+    // A single output declares every replicate as a contig up front.
+    if (single && numReplicates == 0) {
+        printf("The number of replicates is not on the ms command line. Build a sidecar with --build-index to use --single. Exiting!\n");
+        destroy_input(file);
+        kv_destroy(selection);
+        return 1;
+    }
 
-    int numReplicate = 0;
+    // Create the output base name.
+    kstring_t* outputBase = init_kstring(NULL);
+    if (outputPrefix != NULL) {
+        kputs(outputPrefix, outputBase);
+    } else if (strncmp(fileName + strlen(fileName) - 3, ".ms", 3) == 0) {
+        kputsn(fileName, strlen(fileName) - 3, outputBase);
+    } else {
+        kputsn(fileName, strlen(fileName) - 6, outputBase);
+    }
 
-    // Parse all of the replicates.
-    while (true) {
+    // zlib's default level, or zstd's.
+    if (level == -1)
+        level = outputType == 's' ? 3 : 6;
+    if (strategy == -2)
+        strategy = Z_DEFAULT_STRATEGY;
+    Compression_t compression = { outputType == 's' ? FORMAT_ZSTD : FORMAT_BGZF, level, strategy, longMatching };
+
+    // With more than one thread, BGZF blocks or zstd frames are compressed in parallel on a shared pool.
+    bool compress = outputType != 'v';
+    CompressionPool_t* compressionPool = compress && threads > 1 ? init_compression_pool(threads) : NULL;
+    HeaderCache_t* headerCache = compress ? init_header_cache() : NULL;
+    VCFConfig_t config = { ks_str(outputBase), length, unphased, missing, seed, compress, compression, outputType == 'b', threads > 1, compressionPool, headerCache, index, NULL };
+    if (single || perFile > 0) {
+        config.stream = init_vcf_stream(&config, perFile, numReplicates);
+        if (config.stream == NULL) {
+            printf("Could not create the output file. Exiting!\n");
+            close_vcf_stream(&config);
+            destroy_compression_pool(compressionPool);
+            destroy_header_cache(headerCache);
+            destroy_input(file);
+            destroy_kstring(outputBase);
+            kv_destroy(selection);
+            return 1;
+        }
+    }
 
-        int segsites = (int) strtol(ks_str(buffer) + 10, (char**) NULL, 10); 
-
-        // Eat lines until "positions:" is encountered.
-        do {
-            ks_getuntil(stream, '\n', buffer, 0);
-        } while (strncmp(ks_str(buffer), "positions:", 10) != 0);
-
-        // Get the positions of the segsites.
-        int numSpaces = 0, prevIndex;
-        for (int i = 0; i <= ks_len(buffer); i++) {
-            if (ks_str(buffer)[i] == ' ') {
-                if (numSpaces > 0) {
-                    double pos = strtod(ks_str(buffer) + prevIndex, (char**) NULL);
-                    if (numSpaces > kv_size(positions)) {
-                        kv_push(double, positions, pos); 
-                    } else {
-                        kv_A(positions, numSpaces - 1) = pos;
-                    }
-                }
-                prevIndex = i;
-                numSpaces++;
-            }
+    // With more than one thread, the main thread parses replicates and hands them
+    //  to the workers. Two replicates per worker keeps every worker busy while
+    //  bounding memory. Each replicate has its own output file, so the order they finish in does not matter,
+    //  except for a stream, where each worker waits for its turn to append.
+    Pool_t pool = { &config, NULL, NULL };
+    pthread_t* workers = NULL;
+    Replicate_t* replicate = NULL;
+    if (threads > 1) {
+        pool.filled = init_queue(2 * threads);
+        pool.empty = init_queue(2 * threads);
+        for (int i = 0; i < 2 * threads; i++)
+            push_queue(pool.empty, init_replicate(packed));
+        workers = malloc(threads * sizeof(pthread_t));
+        for (int i = 0; i < threads; i++)
+            pthread_create(&workers[i], NULL, convert_replicates, &pool);
+    } else {
+        // Initalize memory used to read in a replicate.
+        replicate = init_replicate(packed);
+    }
+
+    // Parse all of the replicates, stopping after the last requested one.
+    int numConverted = 0;
+    while (line.type == LINE_SEGSITES && numReplicate <= lastReplicate) {
+
+        // Unselected replicates are skipped without being parsed.
+        if (!is_selected(&selection, numReplicate)) {
+            skip_to_segsites(file, &line);
+            numReplicate++;
+            continue;
         }
 
-        // Now, read in all of the samples.
-        int numSamples = 0;
-        while (ks_getuntil(stream, '\n', buffer, 0) > 0 && strncmp(ks_str(buffer), "segsites:", 9) != 0) {
-            if (numSamples >= kv_size(samples)) {
-                kstring_t* temp = calloc(1, sizeof(kstring_t));
-                kputs(ks_str(buffer), temp);
-                kv_push(kstring_t*, samples, temp); 
-            } else {
-                ks_overwrite(ks_str(buffer), kv_A(samples, numSamples));
+        int segsites = (int) strtol(line.text + 10, (char**) NULL, 10); 
+        if (threads > 1)
+            replicate = pop_queue(pool.empty);
+        reset_replicate(replicate, numReplicate, segsites);
+        replicate -> sequence = numConverted++;
+
+        if (segsites > 0) {
+            // Eat lines until "positions:" is encountered.
+            while (read_line(file, &line) && line.type != LINE_POSITIONS);
+
+            // Get the positions of the segsites.
+            parse_positions(replicate, line.text, line.length);
+
+            // Now, read in all of the samples. Lines of a mapped file outlive the replicate,
+            //  so its rows point straight into the page cache.
+            while (read_line(file, &line) && line.type == LINE_DATA) {
+                if (file -> mapped)
+                    add_borrowed_haplotype(replicate, line.text, line.length);
+                else
+                    add_haplotype(replicate, line.text, line.length);
             }
-            numSamples++;
+        } else {
+            // ms prints neither positions nor haplotypes without segregating sites.
+            read_line(file, &line);
         }
 
+        finalize_replicate(replicate);
+
+        // Compression is tuned on the first replicate, before anything is compressed.
+        if (targetMBps > 0 && replicate -> sequence == 0)
+            tune_compression(&config, replicate, targetMBps);
+
         // Convert the ms replicate to vcf.
-        toVCF(fileName, length, unphased, missing, compress, numReplicate, segsites, numSamples, &positions, &samples);
-        
-        // If end of file, exit main loop.
-        if (ks_eof(stream)) {
-            break;
-        }
+        if (threads > 1)
+            push_queue(pool.filled, replicate);
+        else
+            toVCF(&config, replicate);
 
         numReplicate++;
 
-        // More replicates. Read until segsites is encountered.
-        do {
-            ks_getuntil(stream, '\n', buffer, 0);
-        } while (strncmp(ks_str(buffer), "segsites:", 9) != 0);
+        // More replicates. Read until segsites is encountered, or the end of the file.
+        while (line.type != LINE_SEGSITES && read_line(file, &line));
+
+    }
 
+    if (threads > 1) {
+        // Wait for the workers to finish, then collect all of the replicates.
+        close_queue(pool.filled);
+        for (int i = 0; i < threads; i++)
+            pthread_join(workers[i], NULL);
+        for (int i = 0; i < 2 * threads; i++)
+            destroy_replicate(pop_queue(pool.empty));
+        destroy_queue(pool.filled);
+        destroy_queue(pool.empty);
+        free(workers);
+    } else {
+        destroy_replicate(replicate);
     }
 
+    close_vcf_stream(&config);
+    destroy_compression_pool(compressionPool);
+    destroy_header_cache(headerCache);
+
     // Free memory.
-    ks_destroy(stream);
-    free(buffer -> s);
-    free(buffer);
-    kv_destroy(positions);
-    for (int i = 0; i < kv_size(samples); i++) {
-        free(ks_str(kv_A(samples, i)));
-    }
-    kv_destroy(samples);
+    destroy_input(file);
+    destroy_kstring(outputBase);
+    kv_destroy(selection);
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+// File: Output.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Buffered output sink for plain, BGZF, and seekable zstd compressed VCF files.
+
+#include "Output.h"
+
+// Writes a block of bytes to the file.
+// Accepts:
+//  Output_t* output -> The output.
+//  kstring_t* block -> The bytes to write.
+// Returns: void.
+static void write_block(Output_t* output, kstring_t* block) {
+    if (output -> compress) {
+        write_bgzf(output -> bgzf, ks_str(block), ks_len(block));
+        return;
+    }
+    if (!output -> spill) {
+        fwrite(ks_str(block), 1, ks_len(block), output -> fp);
+        return;
+    }
+    // A spill output creates its temporary file with its first block. Once it fails,
+    //  the rest of the records are dropped and the caller has to write them another way.
+    if (output -> failed)
+        return;
+    if (output -> fp == NULL)
+        output -> fp = tmpfile();
+    if (output -> fp == NULL || fwrite(ks_str(block), 1, ks_len(block), output -> fp) != ks_len(block))
+        output -> failed = true;
+}
+
+// The writer stage of a pipelined output. Writes blocks until the ring is closed.
+// Accepts:
+//  void* arg -> The Output_t* to write.
+// Returns: void*, NULL.
+static void* write_blocks(void* arg) {
+    Output_t* output = (Output_t*) arg;
+    kstring_t* block;
+    while ((block = peek_ring(output -> ring)) != NULL) {
+        write_block(output, block);
+        block -> l = 0;
+        release_ring(output -> ring);
+    }
+    return NULL;
+}
+
+Output_t* init_output(char* fileName, bool compress, Compression_t compression, bool pipelined, CompressionPool_t* pool) {
+    Output_t* output = calloc(1, sizeof(Output_t));
+    output -> compress = compress;
+    if (compress) {
+        output -> bgzf = init_bgzf(fileName, compression, pool);
+        if (output -> bgzf == NULL) { free(output); return NULL; }
+    } else {
+        output -> fp = strcmp(fileName, "-") == 0 ? stdout : fopen(fileName, "w");
+        if (output -> fp == NULL) { free(output); return NULL; }
+    }
+    // Leave room for one full record past the block size before reallocating.
+    output -> buffer = init_kstring(NULL);
+    ks_resize(output -> buffer, 2 * OUTPUT_BLOCK_SIZE);
+    if (pipelined) {
+        output -> ring = init_ring(OUTPUT_RING_SIZE, 2 * OUTPUT_BLOCK_SIZE);
+        pthread_create(&(output -> writer), NULL, write_blocks, output);
+    }
+    return output;
+}
+
+Output_t* init_spill_output() {
+    Output_t* output = calloc(1, sizeof(Output_t));
+    output -> spill = true;
+    output -> buffer = init_kstring(NULL);
+    ks_resize(output -> buffer, 2 * OUTPUT_BLOCK_SIZE);
+    return output;
+}
+
+void flush_output(Output_t* output) {
+    if (ks_len(output -> buffer) == 0)
+        return;
+    output -> offset += ks_len(output -> buffer);
+    if (output -> ring != NULL) {
+        // Trade the full buffer for the empty one sitting in the slot.
+        kstring_t* slot = reserve_ring(output -> ring);
+        kstring_t temp = *slot;
+        *slot = *(output -> buffer);
+        *(output -> buffer) = temp;
+        commit_ring(output -> ring);
+    } else {
+        write_block(output, output -> buffer);
+    }
+    output -> buffer -> l = 0;
+}
+
+void write_output_header(Output_t* output, HeaderCache_t* cache) {
+    if (!output -> compress || output -> offset != 0) {
+        flush_output(output);
+        return;
+    }
+    // Nothing has been handed to the writer thread yet, so the file can be written here.
+    write_bgzf_header(output -> bgzf, cache, ks_str(output -> buffer), ks_len(output -> buffer));
+    output -> offset += ks_len(output -> buffer);
+    output -> buffer -> l = 0;
+}
+
+void drain_spill_output(Output_t* spill, Output_t* output) {
+    if (spill -> fp != NULL) {
+        rewind(spill -> fp);
+        size_t n;
+        do {
+            ks_resize(output -> buffer, ks_len(output -> buffer) + OUTPUT_BLOCK_SIZE + 1);
+            n = fread(ks_str(output -> buffer) + ks_len(output -> buffer), 1, OUTPUT_BLOCK_SIZE, spill -> fp);
+            output -> buffer -> l += n;
+            if (ks_len(output -> buffer) >= OUTPUT_BLOCK_SIZE)
+                flush_output(output);
+        } while (n == OUTPUT_BLOCK_SIZE);
+    }
+    kputsn(ks_str(spill -> buffer), ks_len(spill -> buffer), output -> buffer);
+    if (ks_len(output -> buffer) >= OUTPUT_BLOCK_SIZE)
+        flush_output(output);
+    spill -> buffer -> l = 0;
+}
+
+void finish_output(Output_t* output) {
+    flush_output(output);
+    if (output -> ring != NULL) {
+        close_ring(output -> ring);
+        pthread_join(output -> writer, NULL);
+        destroy_ring(output -> ring);
+        output -> ring = NULL;
+    }
+    if (output -> compress)
+        finish_bgzf(output -> bgzf);
+}
+
+void destroy_output(Output_t* output) {
+    if (output == NULL)
+        return;
+    finish_output(output);
+    if (output -> compress)
+        close_bgzf(output -> bgzf);
+    else if (output -> fp == stdout)
+        fflush(output -> fp);
+    else if (output -> fp != NULL)
+        fclose(output -> fp);
+    destroy_kstring(output -> buffer);
+    free(output);
+}
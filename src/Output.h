@@ -0,0 +1,102 @@
+// File: Output.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Buffered output sink for plain, BGZF, and seekable zstd compressed VCF files.
+
+#ifndef _OUTPUT_H_
+#define _OUTPUT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "Ring.h"
+#include "BGZF.h"
+#include "../lib/kstring.h"
+
+// The number of blocks that can wait for the writer thread.
+#define OUTPUT_RING_SIZE 8
+
+// Records are accumulated in the buffer and written once it exceeds this many bytes.
+#define OUTPUT_BLOCK_SIZE 65536
+
+// An output file. Formatters append bytes directly to buffer
+//  and call flush_output once a block has been accumulated.
+//  When pipelined, flushed blocks are passed through a ring to a writer thread
+//  that compresses and writes them while the next block is formatted.
+typedef struct {
+    // If set, fp is unused and bgzf holds the output, in BGZF blocks or zstd frames.
+    bool compress;
+    // The plain file. A spill output creates it with its first flushed block.
+    FILE* fp;
+    // Set for a spill output, and failed is set if its temporary file could not be created or written.
+    bool spill;
+    bool failed;
+    BGZF_t* bgzf;
+    // The pending bytes that have not been written yet.
+    kstring_t* buffer;
+    // The number of bytes flushed so far. The uncompressed offset of the
+    //  next byte appended to buffer is offset + ks_len(buffer).
+    uint64_t offset;
+    // The ring to the writer thread, or NULL if blocks are written by the caller.
+    Ring_t* ring;
+    pthread_t writer;
+} Output_t;
+
+// Open an output file.
+// Accepts:
+//  char* fileName -> The name of the file to create, or "-" for standard output.
+//  bool compress -> If set, the file is BGZF or seekable zstd compressed.
+//  Compression_t compression -> The format and settings of a compressed file.
+//  bool pipelined -> If set, blocks are compressed and written on a separate thread.
+//  CompressionPool_t* pool -> The threads compressing BGZF blocks or zstd frames, or NULL to compress on the writing thread.
+// Returns: Output_t*, the opened output or NULL if the file could not be created.
+Output_t* init_output(char* fileName, bool compress, Compression_t compression, bool pipelined, CompressionPool_t* pool);
+
+// Open an output that holds records until they can be appended to another output. Up to a
+//  block is kept in memory and the rest is spilled to an anonymous temporary file, created
+//  when the first block is flushed. If the file cannot be created or written, failed is set
+//  and later blocks are dropped, so the records have to be formatted again.
+// Accepts: void.
+// Returns: Output_t*, the output.
+Output_t* init_spill_output();
+
+// Write the pending bytes to the file with a single call, or hand them to the writer thread.
+// Accepts:
+//  Output_t* output -> The output to flush.
+// Returns: void.
+void flush_output(Output_t* output);
+
+// Write the pending bytes, which must be the header and all that was appended so far,
+//  in blocks or frames of their own so they can be compressed once for every file of a run.
+//  Plain files are simply flushed.
+// Accepts:
+//  Output_t* output -> The output holding the header.
+//  HeaderCache_t* cache -> The cache shared by the files of the run, or NULL.
+// Returns: void.
+void write_output_header(Output_t* output, HeaderCache_t* cache);
+
+// Append everything written to a spill output to another output a block at a time,
+//  flushing the other output as its blocks fill. The spill output is left empty in memory.
+// Accepts:
+//  Output_t* spill -> The spill output.
+//  Output_t* output -> The output to append to.
+// Returns: void.
+void drain_spill_output(Output_t* spill, Output_t* output);
+
+// Flush the remaining bytes and wait until they are written, so BGZF virtual offsets can be computed.
+//  Nothing more can be written afterwards.
+// Accepts:
+//  Output_t* output -> The output to finish.
+// Returns: void.
+void finish_output(Output_t* output);
+
+// Flush the remaining bytes, close the file, and free the output.
+// Accepts:
+//  Output_t* output -> The output to close.
+// Returns: void.
+void destroy_output(Output_t* output);
+
+#endif
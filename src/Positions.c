@@ -0,0 +1,97 @@
+// File: Positions.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Parse the positions line of ms replicates.
+
+#include "Positions.h"
+
+// The largest integer every smaller integer of which a double holds exactly.
+#define MAX_EXACT_MANTISSA ((uint64_t) 1 << 53)
+
+// A uint64_t holds any 19 digit integer.
+#define MAX_DIGITS 19
+
+// The powers of ten a double holds exactly.
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define MAX_EXACT_POWER 22
+
+#define is_digit(c) ((unsigned char) ((c) - '0') < 10)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// Checks if the eight bytes of a word are all digits.
+// Accepts:
+//  uint64_t v -> Eight characters, the first in the low byte.
+// Returns: bool, true if all are digits.
+static inline bool is_eight_digits(uint64_t v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+// Converts eight digits to an integer with three multiplies instead of eight.
+// Accepts:
+//  uint64_t v -> Eight digits, the first in the low byte.
+// Returns: uint32_t, their value.
+static inline uint32_t parse_eight_digits(uint64_t v) {
+    v -= 0x3030303030303030ULL;
+    // Combine neighbouring digits, then pairs of those, then the two halves.
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return (uint32_t) v;
+}
+#endif
+
+double parse_position(const char* start, const char* end, const char** stop) {
+    const char* p = start;
+    uint64_t mantissa = 0;
+    int digits = 0, fraction = 0;
+    for (; p < end && is_digit(*p) && digits < MAX_DIGITS; p++, digits++)
+        mantissa = 10 * mantissa + (*p - '0');
+    if (p < end && *p == '.') {
+        const char* first = ++p;
+        #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // ms prints a fixed number of decimals, usually enough for eight at a time.
+        for (uint64_t v; p + 8 <= end && digits + 8 <= MAX_DIGITS; p += 8, digits += 8) {
+            memcpy(&v, p, 8);
+            if (!is_eight_digits(v))
+                break;
+            mantissa = 100000000 * mantissa + parse_eight_digits(v);
+        }
+        #endif
+        for (; p < end && is_digit(*p) && digits < MAX_DIGITS; p++, digits++)
+            mantissa = 10 * mantissa + (*p - '0');
+        fraction = p - first;
+    }
+    // Both the mantissa and the power of ten are exact doubles, so one
+    //  correctly rounded division gives the correctly rounded result.
+    bool complete = p == end || (!is_digit(*p) && *p != 'e' && *p != 'E');
+    if (digits > 0 && complete && mantissa <= MAX_EXACT_MANTISSA && fraction <= MAX_EXACT_POWER) {
+        *stop = p;
+        return (double) mantissa / POWERS_OF_TEN[fraction];
+    }
+    return strtod(start, (char**) stop);
+}
+
+void parse_positions(Replicate_t* replicate, const char* text, int length) {
+    const char* end = text + length;
+    // Skip "positions:".
+    const char* p = text + 10;
+    while (true) {
+        while (p < end && *p == ' ')
+            p++;
+        if (p >= end)
+            break;
+        const char* stop;
+        double pos = parse_position(p, end, &stop);
+        if (stop == p) {
+            // Not a number. Skip the token.
+            while (p < end && *p != ' ')
+                p++;
+            continue;
+        }
+        kv_push(double, replicate -> positions, pos);
+        p = stop;
+    }
+}
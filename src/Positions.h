@@ -0,0 +1,33 @@
+// File: Positions.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Parse the positions line of ms replicates.
+
+#ifndef _POSITIONS_H_
+#define _POSITIONS_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "Replicate.h"
+
+// Parse one position. Plain decimals with few enough digits are converted
+//  exactly without strtod. Anything else falls back to strtod, so the result
+//  is always the correctly rounded double.
+// Accepts:
+//  const char* start -> The first character of the number.
+//  const char* end -> One past the last character that may be read.
+//  const char** stop -> Set to the character after the number, or start if there is no number.
+// Returns: double, the position.
+double parse_position(const char* start, const char* end, const char** stop);
+
+// Parse a "positions:" line into the positions of a replicate.
+// Accepts:
+//  Replicate_t* replicate -> The replicate to append the positions to.
+//  const char* text -> The line, terminated after length characters.
+//  int length -> The length of the line.
+// Returns: void.
+void parse_positions(Replicate_t* replicate, const char* text, int length);
+
+#endif
@@ -0,0 +1,59 @@
+// File: Queue.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: A bounded, blocking queue used to hand work between threads.
+
+#include "Queue.h"
+
+Queue_t* init_queue(int capacity) {
+    Queue_t* queue = calloc(1, sizeof(Queue_t));
+    queue -> items = calloc(capacity, sizeof(void*));
+    queue -> capacity = capacity;
+    pthread_mutex_init(&(queue -> lock), NULL);
+    pthread_cond_init(&(queue -> notEmpty), NULL);
+    pthread_cond_init(&(queue -> notFull), NULL);
+    return queue;
+}
+
+void push_queue(Queue_t* queue, void* item) {
+    pthread_mutex_lock(&(queue -> lock));
+    while (queue -> size == queue -> capacity)
+        pthread_cond_wait(&(queue -> notFull), &(queue -> lock));
+    queue -> items[(queue -> head + queue -> size) % queue -> capacity] = item;
+    queue -> size++;
+    pthread_cond_signal(&(queue -> notEmpty));
+    pthread_mutex_unlock(&(queue -> lock));
+}
+
+void* pop_queue(Queue_t* queue) {
+    pthread_mutex_lock(&(queue -> lock));
+    while (queue -> size == 0 && !queue -> closed)
+        pthread_cond_wait(&(queue -> notEmpty), &(queue -> lock));
+    void* item = NULL;
+    if (queue -> size > 0) {
+        item = queue -> items[queue -> head];
+        queue -> head = (queue -> head + 1) % queue -> capacity;
+        queue -> size--;
+        pthread_cond_signal(&(queue -> notFull));
+    }
+    pthread_mutex_unlock(&(queue -> lock));
+    return item;
+}
+
+void close_queue(Queue_t* queue) {
+    pthread_mutex_lock(&(queue -> lock));
+    queue -> closed = true;
+    pthread_cond_broadcast(&(queue -> notEmpty));
+    pthread_mutex_unlock(&(queue -> lock));
+}
+
+void destroy_queue(Queue_t* queue) {
+    if (queue == NULL)
+        return;
+    pthread_mutex_destroy(&(queue -> lock));
+    pthread_cond_destroy(&(queue -> notEmpty));
+    pthread_cond_destroy(&(queue -> notFull));
+    free(queue -> items);
+    free(queue);
+}
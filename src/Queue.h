@@ -0,0 +1,59 @@
+// File: Queue.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: A bounded, blocking queue used to hand work between threads.
+
+#ifndef _QUEUE_H_
+#define _QUEUE_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// A first-in first-out queue of pointers with a fixed capacity.
+//  Pushing blocks while the queue is full and popping blocks while it is empty.
+typedef struct {
+    void** items;
+    int capacity;
+    int head;
+    int size;
+    // Once closed, pop returns NULL after the queue drains.
+    bool closed;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} Queue_t;
+
+// Create an empty queue.
+// Accepts:
+//  int capacity -> The maximum number of items held at once.
+// Returns: Queue_t*, the empty queue.
+Queue_t* init_queue(int capacity);
+
+// Add an item to the back of the queue, waiting for room if needed.
+// Accepts:
+//  Queue_t* queue -> The queue.
+//  void* item -> The item to add. Must not be NULL.
+// Returns: void.
+void push_queue(Queue_t* queue, void* item);
+
+// Remove the item at the front of the queue, waiting for one if needed.
+// Accepts:
+//  Queue_t* queue -> The queue.
+// Returns: void*, the item or NULL if the queue is closed and empty.
+void* pop_queue(Queue_t* queue);
+
+// Signal that no more items will be pushed and wake all waiting threads.
+// Accepts:
+//  Queue_t* queue -> The queue.
+// Returns: void.
+void close_queue(Queue_t* queue);
+
+// Free the queue. The items themselves are not freed.
+// Accepts:
+//  Queue_t* queue -> The queue.
+// Returns: void.
+void destroy_queue(Queue_t* queue);
+
+#endif
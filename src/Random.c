@@ -0,0 +1,85 @@
+// File: Random.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Counter-based random number streams built on Philox4x32-10.
+
+#include "Random.h"
+
+// The multipliers and key increments of Philox4x32.
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+void philox(const uint32_t* counter, const uint32_t* key, uint32_t* out) {
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+        c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t) p1;
+        c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t) p0;
+        k0 += PHILOX_W0; k1 += PHILOX_W1;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+void init_random(Random_t* random, uint64_t seed, uint32_t replicate, uint32_t site, uint32_t stream) {
+    random -> key[0] = (uint32_t) seed;
+    random -> key[1] = (uint32_t) (seed >> 32);
+    random -> counter[0] = 0;
+    random -> counter[1] = site;
+    random -> counter[2] = replicate;
+    random -> counter[3] = stream;
+    random -> used = 4;
+}
+
+// Computes four consecutive Philox blocks with the rounds interleaved
+//  across lanes, so the compiler can vectorize the multiplies.
+// Accepts:
+//  const uint32_t* counter -> The counter of the first block.
+//  const uint32_t* key -> The two key words.
+//  uint32_t (*out)[4] -> The four output blocks.
+// Returns: void.
+static void philox_x4(const uint32_t* counter, const uint32_t* key, uint32_t (*out)[4]) {
+    uint32_t c0[4], c1[4], c2[4], c3[4];
+    for (int l = 0; l < 4; l++) {
+        c0[l] = counter[0] + l; c1[l] = counter[1]; c2[l] = counter[2]; c3[l] = counter[3];
+    }
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; round++) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t p0 = (uint64_t) PHILOX_M0 * c0[l];
+            uint64_t p1 = (uint64_t) PHILOX_M1 * c2[l];
+            c0[l] = (uint32_t) (p1 >> 32) ^ c1[l] ^ k0;
+            c1[l] = (uint32_t) p1;
+            c2[l] = (uint32_t) (p0 >> 32) ^ c3[l] ^ k1;
+            c3[l] = (uint32_t) p0;
+        }
+        k0 += PHILOX_W0; k1 += PHILOX_W1;
+    }
+    for (int l = 0; l < 4; l++) {
+        out[l][0] = c0[l]; out[l][1] = c1[l]; out[l][2] = c2[l]; out[l][3] = c3[l];
+    }
+}
+
+void fill_random(Random_t* random, uint64_t* out, int n) {
+    int i = 0;
+    // Bulk generation only starts on a block boundary, where it matches next_random64.
+    if (random -> used == 4) {
+        uint32_t blocks[4][4];
+        for (; i + 8 <= n; i += 8) {
+            philox_x4(random -> counter, random -> key, blocks);
+            random -> counter[0] += 4;
+            for (int b = 0; b < 4; b++) {
+                out[i + 2 * b] = blocks[b][0] | (uint64_t) blocks[b][1] << 32;
+                out[i + 2 * b + 1] = blocks[b][2] | (uint64_t) blocks[b][3] << 32;
+            }
+        }
+    }
+    for (; i < n; i++)
+        out[i] = next_random64(random);
+}
@@ -0,0 +1,100 @@
+// File: Random.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Counter-based random number streams built on Philox4x32-10.
+
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+// The independent streams drawn at each site.
+#define STREAM_PHASE 0
+#define STREAM_MISSING 1
+
+// A stream of random numbers. The output is a pure function of the seed,
+//  the replicate, the site, the stream, and how many numbers have been drawn,
+//  so any part of any replicate can be generated on any thread and reproduced exactly.
+typedef struct {
+    uint32_t key[2];
+    // The counter of the next block: index, site, replicate, and stream.
+    uint32_t counter[4];
+    // The current block of output and the number of its words already used.
+    uint32_t block[4];
+    int used;
+} Random_t;
+
+// Compute one Philox4x32-10 block.
+// Accepts:
+//  const uint32_t* counter -> The four counter words.
+//  const uint32_t* key -> The two key words.
+//  uint32_t* out -> The four output words.
+// Returns: void.
+void philox(const uint32_t* counter, const uint32_t* key, uint32_t* out);
+
+// Start a stream.
+// Accepts:
+//  Random_t* random -> The stream to start.
+//  uint64_t seed -> The user supplied seed.
+//  uint32_t replicate -> The replicate number.
+//  uint32_t site -> The site within the replicate.
+//  uint32_t stream -> Which of the site's streams to start.
+// Returns: void.
+void init_random(Random_t* random, uint64_t seed, uint32_t replicate, uint32_t site, uint32_t stream);
+
+// Fill an array with 64-bit random numbers. Draws the same numbers
+//  as repeated calls to next_random64, four blocks at a time.
+// Accepts:
+//  Random_t* random -> The stream.
+//  uint64_t* out -> The destination.
+//  int n -> The number of values.
+// Returns: void.
+void fill_random(Random_t* random, uint64_t* out, int n);
+
+// Get the next 32 random bits.
+// Accepts:
+//  Random_t* random -> The stream.
+// Returns: uint32_t, the bits.
+static inline uint32_t next_random32(Random_t* random) {
+    if (random -> used == 4) {
+        philox(random -> counter, random -> key, random -> block);
+        random -> counter[0]++;
+        random -> used = 0;
+    }
+    return random -> block[random -> used++];
+}
+
+// Get the next 64 random bits.
+// Accepts:
+//  Random_t* random -> The stream.
+// Returns: uint64_t, the bits.
+static inline uint64_t next_random64(Random_t* random) {
+    uint64_t low = next_random32(random);
+    return low | (uint64_t) next_random32(random) << 32;
+}
+
+// Get a uniform random double in [0, 1) with 53 random bits.
+// Accepts:
+//  Random_t* random -> The stream.
+// Returns: double, the number.
+static inline double next_uniform(Random_t* random) {
+    return (next_random64(random) >> 11) * 0x1.0p-53;
+}
+
+// Get the number of failures before the next success of a Bernoulli trial,
+//  drawn from a geometric distribution with a single uniform.
+// Accepts:
+//  Random_t* random -> The stream.
+//  double logFail -> The log of the probability a trial fails, log1p(-p).
+//  int limit -> Gaps at or beyond the limit are returned as the limit.
+// Returns: int, the gap.
+static inline int next_geometric(Random_t* random, double logFail, int limit) {
+    // 1 - u lies in (0, 1], so the log is finite.
+    double gap = floor(log(1.0 - next_uniform(random)) / logFail);
+    return gap < limit ? (int) gap : limit;
+}
+
+#endif
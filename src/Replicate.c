@@ -0,0 +1,136 @@
+// File: Replicate.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Storage for one parsed ms replicate.
+
+#include "Replicate.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+Replicate_t* init_replicate(bool packed) {
+    Replicate_t* replicate = calloc(1, sizeof(Replicate_t));
+    replicate -> packed = packed;
+    kv_init(replicate -> positions);
+    kv_init(replicate -> exceptions);
+    kv_init(replicate -> borrowed);
+    return replicate;
+}
+
+void reset_replicate(Replicate_t* replicate, int numReplicate, int numSegsites) {
+    replicate -> numReplicate = numReplicate;
+    replicate -> numSegsites = numSegsites;
+    replicate -> numSamples = 0;
+    if (replicate -> packed)
+        replicate -> stride = (numSegsites + 63) / 64 * sizeof(uint64_t);
+    else
+        replicate -> stride = (numSegsites + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+    kv_size(replicate -> positions) = 0;
+    kv_size(replicate -> exceptions) = 0;
+    kv_size(replicate -> borrowed) = 0;
+}
+
+// Records every allele in a run of characters that is neither '0' nor '1'.
+// Accepts:
+//  Replicate_t* replicate -> The replicate.
+//  const char* haplotype -> The alleles of the haplotype.
+//  int start -> The first site to check.
+//  int end -> One past the last site to check.
+// Returns: void.
+static void add_exceptions(Replicate_t* replicate, const char* haplotype, int start, int end) {
+    for (int s = start; s < end; s++) {
+        if (haplotype[s] != '0' && haplotype[s] != '1') {
+            Allele_t allele = { replicate -> numSamples, s, haplotype[s] };
+            kv_push(Allele_t, replicate -> exceptions, allele);
+        }
+    }
+}
+
+// Packs a haplotype into a bitset.
+// Accepts:
+//  Replicate_t* replicate -> The replicate.
+//  uint64_t* row -> The destination bitset.
+//  const char* haplotype -> The alleles of the haplotype.
+//  int length -> The number of sites to pack.
+// Returns: void.
+static void pack_haplotype(Replicate_t* replicate, uint64_t* row, const char* haplotype, int length) {
+    memset(row, 0, replicate -> stride);
+    int s = 0;
+    #ifdef __SSE2__
+    // Sixteen sites at a time. Words are 64 bits, so a chunk never straddles two words.
+    const __m128i ones = _mm_set1_epi8('1'), zeros = _mm_set1_epi8('0');
+    for (; s + 16 <= length; s += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) (haplotype + s));
+        unsigned isOne = _mm_movemask_epi8(_mm_cmpeq_epi8(x, ones));
+        unsigned isZero = _mm_movemask_epi8(_mm_cmpeq_epi8(x, zeros));
+        row[s >> 6] |= (uint64_t) isOne << (s & 63);
+        if ((isOne | isZero) != 0xFFFF)
+            add_exceptions(replicate, haplotype, s, s + 16);
+    }
+    #endif
+    for (; s < length; s++) {
+        if (haplotype[s] == '1')
+            row[s >> 6] |= (uint64_t) 1 << (s & 63);
+        else if (haplotype[s] != '0')
+            add_exceptions(replicate, haplotype, s, s + 1);
+    }
+}
+
+void add_haplotype(Replicate_t* replicate, const char* haplotype, int length) {
+    size_t needed = (size_t) (replicate -> numSamples + 1) * replicate -> stride;
+    if (needed > replicate -> capacity) {
+        size_t capacity = replicate -> capacity == 0 ? needed : replicate -> capacity;
+        while (capacity < needed)
+            capacity *= 2;
+        replicate -> haplotypes = realloc(replicate -> haplotypes, capacity);
+        replicate -> capacity = capacity;
+    }
+    if (length > replicate -> numSegsites)
+        length = replicate -> numSegsites;
+    if (replicate -> packed) {
+        // Sites missing from a short line are left as '0' alleles.
+        pack_haplotype(replicate, get_packed_haplotype(replicate, replicate -> numSamples), haplotype, length);
+    } else {
+        char* row = get_haplotype(replicate, replicate -> numSamples);
+        memcpy(row, haplotype, length);
+        memset(row + length, '0', replicate -> numSegsites - length);
+    }
+    kv_push(const char*, replicate -> borrowed, NULL);
+    replicate -> numSamples++;
+}
+
+void add_borrowed_haplotype(Replicate_t* replicate, const char* haplotype, int length) {
+    if (replicate -> packed || length < replicate -> numSegsites) {
+        add_haplotype(replicate, haplotype, length);
+        return;
+    }
+    kv_push(const char*, replicate -> borrowed, haplotype);
+    replicate -> numSamples++;
+}
+
+// Orders non-binary alleles by site and then by haplotype.
+static int compare_alleles(const void* a, const void* b) {
+    const Allele_t* x = a;
+    const Allele_t* y = b;
+    if (x -> site != y -> site)
+        return x -> site < y -> site ? -1 : 1;
+    return (x -> haplotype > y -> haplotype) - (x -> haplotype < y -> haplotype);
+}
+
+void finalize_replicate(Replicate_t* replicate) {
+    // Exceptions are gathered haplotype by haplotype but consumed site by site.
+    if (kv_size(replicate -> exceptions) > 1)
+        qsort(replicate -> exceptions.a, kv_size(replicate -> exceptions), sizeof(Allele_t), compare_alleles);
+}
+
+void destroy_replicate(Replicate_t* replicate) {
+    if (replicate == NULL)
+        return;
+    kv_destroy(replicate -> positions);
+    kv_destroy(replicate -> exceptions);
+    kv_destroy(replicate -> borrowed);
+    free(replicate -> haplotypes);
+    free(replicate);
+}
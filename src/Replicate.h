@@ -0,0 +1,125 @@
+// File: Replicate.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Storage for one parsed ms replicate.
+
+#ifndef _REPLICATE_H_
+#define _REPLICATE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../lib/kvec.h"
+
+// Rows of the haplotype matrix are padded to a multiple of this many bytes.
+#define ROW_ALIGNMENT 16
+
+// An allele other than '0' or '1' in a packed replicate.
+typedef struct {
+    int haplotype;
+    int site;
+    char allele;
+} Allele_t;
+
+// One ms replicate. The haplotypes are held in a single arena as a dense
+//  numSamples x numSegsites matrix. Haplotype i begins at haplotypes + i * stride.
+//  The arena is reused between replicates and only grows.
+//  In packed mode, each haplotype is a bitset with one bit per site,
+//  stored least significant bit first in 64-bit words. A set bit is a '1' allele,
+//  and any allele that is neither '0' nor '1' is kept in exceptions with a clear bit.
+typedef struct {
+    bool packed;
+    int numReplicate;
+    // The place of the replicate among those converted, which fixes where it goes in a single output stream.
+    int sequence;
+    int numSegsites;
+    int numSamples;
+    // The positions of the segregating sites in [0, 1).
+    kvec_t(double) positions;
+    // The distance in bytes between consecutive haplotypes.
+    size_t stride;
+    // The haplotype arena and its size in bytes.
+    char* haplotypes;
+    size_t capacity;
+    // For each haplotype, its row in memory owned by the caller, or NULL if it is in the arena.
+    kvec_t(const char*) borrowed;
+    // The non-binary alleles of a packed replicate, sorted by site.
+    kvec_t(Allele_t) exceptions;
+} Replicate_t;
+
+// Create an empty replicate.
+// Accepts:
+//  bool packed -> If set, haplotypes are stored with one bit per site.
+// Returns: Replicate_t*, the empty replicate.
+Replicate_t* init_replicate(bool packed);
+
+// Clear the replicate so it can hold a new matrix. The arena is kept.
+// Accepts:
+//  Replicate_t* replicate -> The replicate to clear.
+//  int numReplicate -> The number of the new replicate.
+//  int numSegsites -> The number of segregating sites in the new replicate.
+// Returns: void.
+void reset_replicate(Replicate_t* replicate, int numReplicate, int numSegsites);
+
+// Append a haplotype to the matrix, growing the arena if needed.
+//  Characters past numSegsites are ignored and short lines are padded with '0'.
+// Accepts:
+//  Replicate_t* replicate -> The replicate to append to.
+//  const char* haplotype -> The alleles of the haplotype.
+//  int length -> The number of characters in haplotype.
+// Returns: void.
+void add_haplotype(Replicate_t* replicate, const char* haplotype, int length);
+
+// Append a haplotype to the matrix without copying it. The caller keeps the
+//  alleles valid until the replicate is reset. Lines that are too short to be
+//  used as a row, and all lines of a packed replicate, are copied instead.
+// Accepts:
+//  Replicate_t* replicate -> The replicate to append to.
+//  const char* haplotype -> The alleles of the haplotype.
+//  int length -> The number of characters in haplotype.
+// Returns: void.
+void add_borrowed_haplotype(Replicate_t* replicate, const char* haplotype, int length);
+
+// Finish the replicate once all of the haplotypes have been added.
+// Accepts:
+//  Replicate_t* replicate -> The replicate.
+// Returns: void.
+void finalize_replicate(Replicate_t* replicate);
+
+// Get a haplotype from the matrix.
+// Accepts:
+//  Replicate_t* replicate -> The replicate.
+//  int i -> The index of the haplotype.
+// Returns: char*, the start of the haplotype's row.
+static inline char* get_haplotype(Replicate_t* replicate, int i) {
+    return replicate -> haplotypes + (size_t) i * replicate -> stride;
+}
+
+// Get the row of a haplotype, wherever it is held.
+// Accepts:
+//  Replicate_t* replicate -> The replicate.
+//  int i -> The index of the haplotype.
+// Returns: const char*, the start of the haplotype's alleles.
+static inline const char* get_row(Replicate_t* replicate, int i) {
+    const char* row = kv_A(replicate -> borrowed, i);
+    return row != NULL ? row : get_haplotype(replicate, i);
+}
+
+// Get a haplotype from a packed matrix.
+// Accepts:
+//  Replicate_t* replicate -> The packed replicate.
+//  int i -> The index of the haplotype.
+// Returns: uint64_t*, the words of the haplotype's bitset.
+static inline uint64_t* get_packed_haplotype(Replicate_t* replicate, int i) {
+    return (uint64_t*) get_haplotype(replicate, i);
+}
+
+// Free all memory associated with a replicate.
+// Accepts:
+//  Replicate_t* replicate -> The replicate to free.
+// Returns: void.
+void destroy_replicate(Replicate_t* replicate);
+
+#endif
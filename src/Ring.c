@@ -0,0 +1,80 @@
+// File: Ring.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: A lock-free single-producer single-consumer ring of byte buffers
+//  used to connect the stages of the conversion pipeline.
+
+#include "Ring.h"
+#include <sched.h>
+#include <time.h>
+
+// Waits for the other side of the ring. Spins briefly, then yields,
+//  then sleeps so an idle stage does not hold a core.
+// Accepts:
+//  int* attempts -> The number of times the caller has waited so far.
+// Returns: void.
+static inline void backoff(int* attempts) {
+    if (*attempts < 64) {
+        // Spin.
+    } else if (*attempts < 128) {
+        sched_yield();
+    } else {
+        struct timespec pause = { 0, 50000 };
+        nanosleep(&pause, NULL);
+    }
+    (*attempts)++;
+}
+
+Ring_t* init_ring(int capacity, size_t slotSize) {
+    Ring_t* ring = calloc(1, sizeof(Ring_t));
+    ring -> slots = calloc(capacity, sizeof(kstring_t));
+    for (int i = 0; i < capacity; i++)
+        ks_resize(&(ring -> slots[i]), slotSize);
+    ring -> capacity = capacity;
+    atomic_init(&(ring -> head), 0);
+    atomic_init(&(ring -> tail), 0);
+    atomic_init(&(ring -> closed), false);
+    return ring;
+}
+
+kstring_t* reserve_ring(Ring_t* ring) {
+    size_t tail = atomic_load_explicit(&(ring -> tail), memory_order_relaxed);
+    int attempts = 0;
+    while (tail - atomic_load_explicit(&(ring -> head), memory_order_acquire) == ring -> capacity)
+        backoff(&attempts);
+    return &(ring -> slots[tail % ring -> capacity]);
+}
+
+void commit_ring(Ring_t* ring) {
+    atomic_fetch_add_explicit(&(ring -> tail), 1, memory_order_release);
+}
+
+kstring_t* peek_ring(Ring_t* ring) {
+    size_t head = atomic_load_explicit(&(ring -> head), memory_order_relaxed);
+    int attempts = 0;
+    while (atomic_load_explicit(&(ring -> tail), memory_order_acquire) == head) {
+        // The tail must be checked again after seeing closed, in case the last commit raced it.
+        if (atomic_load_explicit(&(ring -> closed), memory_order_acquire) && atomic_load_explicit(&(ring -> tail), memory_order_acquire) == head)
+            return NULL;
+        backoff(&attempts);
+    }
+    return &(ring -> slots[head % ring -> capacity]);
+}
+
+void release_ring(Ring_t* ring) {
+    atomic_fetch_add_explicit(&(ring -> head), 1, memory_order_release);
+}
+
+void close_ring(Ring_t* ring) {
+    atomic_store_explicit(&(ring -> closed), true, memory_order_release);
+}
+
+void destroy_ring(Ring_t* ring) {
+    if (ring == NULL)
+        return;
+    for (int i = 0; i < ring -> capacity; i++)
+        free(ring -> slots[i].s);
+    free(ring -> slots);
+    free(ring);
+}
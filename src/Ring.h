@@ -0,0 +1,73 @@
+// File: Ring.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: A lock-free single-producer single-consumer ring of byte buffers
+//  used to connect the stages of the conversion pipeline.
+
+#ifndef _RING_H_
+#define _RING_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "../lib/kstring.h"
+
+// A ring of buffers passed from exactly one producer thread to exactly one consumer thread.
+//  The producer fills the slot returned by reserve_ring and publishes it with commit_ring.
+//  The consumer reads the slot returned by peek_ring and hands it back with release_ring.
+//  Slots are reused, so their memory is only allocated once.
+typedef struct {
+    kstring_t* slots;
+    int capacity;
+    // The number of slots consumed and produced so far.
+    _Atomic size_t head;
+    _Atomic size_t tail;
+    // Set by the producer once it will not commit any more slots.
+    _Atomic bool closed;
+} Ring_t;
+
+// Create a ring.
+// Accepts:
+//  int capacity -> The number of slots.
+//  size_t slotSize -> The number of bytes preallocated in each slot.
+// Returns: Ring_t*, the empty ring.
+Ring_t* init_ring(int capacity, size_t slotSize);
+
+// Get the next free slot, waiting for the consumer if the ring is full.
+// Accepts:
+//  Ring_t* ring -> The ring.
+// Returns: kstring_t*, the slot to fill.
+kstring_t* reserve_ring(Ring_t* ring);
+
+// Publish the slot returned by reserve_ring to the consumer.
+// Accepts:
+//  Ring_t* ring -> The ring.
+// Returns: void.
+void commit_ring(Ring_t* ring);
+
+// Get the oldest filled slot, waiting for the producer if the ring is empty.
+// Accepts:
+//  Ring_t* ring -> The ring.
+// Returns: kstring_t*, the slot to read or NULL if the ring is closed and drained.
+kstring_t* peek_ring(Ring_t* ring);
+
+// Return the slot returned by peek_ring to the producer.
+// Accepts:
+//  Ring_t* ring -> The ring.
+// Returns: void.
+void release_ring(Ring_t* ring);
+
+// Signal that the producer is done.
+// Accepts:
+//  Ring_t* ring -> The ring.
+// Returns: void.
+void close_ring(Ring_t* ring);
+
+// Free the ring and its slots.
+// Accepts:
+//  Ring_t* ring -> The ring.
+// Returns: void.
+void destroy_ring(Ring_t* ring);
+
+#endif
@@ -0,0 +1,408 @@
+// File: Seek.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Random access into ms files through a sidecar of replicate offsets and gzip access points.
+
+#include "Seek.h"
+
+// The number of compressed bytes read at once.
+#define SEEK_CHUNK 262144
+
+// The first bytes of a sidecar.
+#define SEEK_MAGIC "MSI\1"
+
+// The length of a gzip member's trailer.
+#define GZIP_TRAILER 8
+
+struct Inflater_t {
+    int fd;
+    z_stream stream;
+    // If set, the stream was restarted inside a member without its header.
+    bool raw;
+    unsigned char* input;
+    // The number of trailer bytes left to skip after a raw member ends.
+    int trailer;
+    bool eof;
+};
+
+// Records the offset of every "//" line in a run of the file. The state
+//  carries across runs: 0 at the start of a line, 1 after a '/' at the start
+//  of a line, and 2 anywhere else.
+// Accepts:
+//  SeekIndex_t* index -> The index.
+//  int* state -> The state of the scan.
+//  const unsigned char* data -> The run.
+//  size_t length -> The number of bytes in the run.
+//  uint64_t offset -> The uncompressed offset of the run.
+// Returns: void.
+static void scan_replicates(SeekIndex_t* index, int* state, const unsigned char* data, size_t length, uint64_t offset) {
+    size_t p = 0;
+    while (p < length) {
+        if (*state == 2) {
+            const unsigned char* newline = memchr(data + p, '\n', length - p);
+            if (newline == NULL)
+                return;
+            p = newline - data + 1;
+            *state = 0;
+        } else if (data[p] == '/') {
+            if (*state == 1) {
+                kv_push(uint64_t, index -> replicates, offset + p - 1);
+                *state = 2;
+            } else {
+                *state = 1;
+            }
+            p++;
+        } else {
+            *state = data[p] == '\n' ? 0 : 2;
+            p++;
+        }
+    }
+}
+
+// Records an access point at the current block boundary.
+// Accepts:
+//  SeekIndex_t* index -> The index.
+//  z_stream* stream -> The stream, stopped at the boundary.
+//  uint64_t in -> The number of compressed bytes consumed.
+//  uint64_t out -> The number of uncompressed bytes produced.
+//  const unsigned char* window -> The circular output buffer.
+// Returns: void.
+static void add_access_point(SeekIndex_t* index, z_stream* stream, uint64_t in, uint64_t out, const unsigned char* window) {
+    // The newest bytes are at the front of the circular buffer.
+    unsigned char dictionary[SEEK_WINDOW];
+    int left = stream -> avail_out, dictionaryLength = SEEK_WINDOW;
+    if (out >= SEEK_WINDOW) {
+        memcpy(dictionary, window + SEEK_WINDOW - left, left);
+        memcpy(dictionary + left, window, SEEK_WINDOW - left);
+    } else {
+        dictionaryLength = out;
+        memcpy(dictionary, window, out);
+    }
+    AccessPoint_t point = { out, in, stream -> data_type & 7, NULL, 0 };
+    uLongf length = compressBound(dictionaryLength);
+    point.window = malloc(length);
+    compress2(point.window, &length, dictionary, dictionaryLength, Z_BEST_COMPRESSION);
+    point.windowLength = length;
+    kv_push(AccessPoint_t, index -> points, point);
+}
+
+// Indexes a gzipped file. Concatenated members are followed, and anything
+//  that fails to inflate right after a member ends is ignored like gzread does.
+// Accepts:
+//  SeekIndex_t* index -> The index.
+//  int fd -> The open file.
+//  uint64_t span -> The number of uncompressed bytes between access points.
+// Returns: bool, true if the whole file was read.
+static bool build_gzipped(SeekIndex_t* index, int fd, uint64_t span) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    // Expect a gzip header.
+    if (inflateInit2(&stream, 31) != Z_OK)
+        return false;
+    unsigned char* input = malloc(SEEK_CHUNK);
+    unsigned char* window = malloc(SEEK_WINDOW);
+    uint64_t in = 0, out = 0, last = 0;
+    int state = 0, ret = Z_OK;
+    bool success = true, memberStart = false;
+    while (true) {
+        if (stream.avail_in == 0) {
+            ssize_t n = read(fd, input, SEEK_CHUNK);
+            if (n < 0)
+                success = false;
+            if (n <= 0)
+                break;
+            stream.next_in = input;
+            stream.avail_in = n;
+        }
+        if (ret == Z_STREAM_END) {
+            inflateReset(&stream);
+            memberStart = true;
+        }
+        if (stream.avail_out == 0) {
+            stream.next_out = window;
+            stream.avail_out = SEEK_WINDOW;
+        }
+        unsigned char* first = stream.next_out;
+        in += stream.avail_in;
+        out += stream.avail_out;
+        // Stop at each block boundary to consider an access point.
+        ret = inflate(&stream, Z_BLOCK);
+        in -= stream.avail_in;
+        out -= stream.avail_out;
+        scan_replicates(index, &state, first, stream.next_out - first, out - (stream.next_out - first));
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+            success = memberStart;
+            break;
+        }
+        if (stream.next_out != first)
+            memberStart = false;
+        // Bit 7 marks a boundary and bit 6 the end of a member's last block.
+        if ((stream.data_type & 128) && !(stream.data_type & 64) && out - last >= span) {
+            add_access_point(index, &stream, in, out, window);
+            last = out;
+        }
+    }
+    inflateEnd(&stream);
+    free(input);
+    free(window);
+    return success;
+}
+
+// Indexes a plain file. Only the replicates are recorded.
+// Accepts:
+//  SeekIndex_t* index -> The index.
+//  int fd -> The open file.
+// Returns: bool, true if the whole file was read.
+static bool build_plain(SeekIndex_t* index, int fd) {
+    unsigned char* input = malloc(SEEK_CHUNK);
+    uint64_t out = 0;
+    int state = 0;
+    ssize_t n;
+    while ((n = read(fd, input, SEEK_CHUNK)) > 0) {
+        scan_replicates(index, &state, input, n, out);
+        out += n;
+    }
+    free(input);
+    return n == 0;
+}
+
+SeekIndex_t* build_seek_index(const char* fileName, uint64_t span) {
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat info;
+    unsigned char magic[2];
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+    SeekIndex_t* index = calloc(1, sizeof(SeekIndex_t));
+    index -> fileSize = info.st_size;
+    index -> gzipped = pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+    kv_init(index -> points);
+    kv_init(index -> replicates);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    bool success = index -> gzipped ? build_gzipped(index, fd, span) : build_plain(index, fd);
+    close(fd);
+    if (!success) {
+        destroy_seek_index(index);
+        return NULL;
+    }
+    return index;
+}
+
+// Appends little-endian integers to the sidecar.
+static inline void put32(kstring_t* out, uint32_t x) {
+    char b[4] = { x, x >> 8, x >> 16, x >> 24 };
+    kputsn(b, 4, out);
+}
+static inline void put64(kstring_t* out, uint64_t x) {
+    put32(out, (uint32_t) x);
+    put32(out, (uint32_t) (x >> 32));
+}
+
+bool write_seek_index(SeekIndex_t* index, const char* fileName) {
+    kstring_t* out = init_kstring(NULL);
+    kputsn(SEEK_MAGIC, 4, out);
+    put32(out, index -> gzipped);
+    put64(out, index -> fileSize);
+    put64(out, kv_size(index -> points));
+    for (int i = 0; i < kv_size(index -> points); i++) {
+        AccessPoint_t* point = &kv_A(index -> points, i);
+        put64(out, point -> out);
+        put64(out, point -> in);
+        put32(out, point -> bits);
+        put32(out, point -> windowLength);
+        kputsn((char*) point -> window, point -> windowLength, out);
+    }
+    put64(out, kv_size(index -> replicates));
+    for (int i = 0; i < kv_size(index -> replicates); i++)
+        put64(out, kv_A(index -> replicates, i));
+    FILE* fp = fopen(fileName, "wb");
+    bool success = fp != NULL && fwrite(ks_str(out), 1, ks_len(out), fp) == ks_len(out);
+    if (fp != NULL && fclose(fp) != 0)
+        success = false;
+    destroy_kstring(out);
+    return success;
+}
+
+// Reads little-endian integers from the sidecar, failing past its end.
+static inline bool get32(const unsigned char** p, const unsigned char* end, uint32_t* x) {
+    if (end - *p < 4)
+        return false;
+    *x = (*p)[0] | (*p)[1] << 8 | (*p)[2] << 16 | (uint32_t) (*p)[3] << 24;
+    *p += 4;
+    return true;
+}
+static inline bool get64(const unsigned char** p, const unsigned char* end, uint64_t* x) {
+    uint32_t low, high;
+    if (!get32(p, end, &low) || !get32(p, end, &high))
+        return false;
+    *x = low | (uint64_t) high << 32;
+    return true;
+}
+
+SeekIndex_t* read_seek_index(const char* fileName, int fd) {
+    FILE* fp = fopen(fileName, "rb");
+    if (fp == NULL)
+        return NULL;
+    kstring_t* data = init_kstring(NULL);
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+        kputsn(chunk, n, data);
+    fclose(fp);
+
+    SeekIndex_t* index = calloc(1, sizeof(SeekIndex_t));
+    kv_init(index -> points);
+    kv_init(index -> replicates);
+    const unsigned char* p = (const unsigned char*) ks_str(data);
+    const unsigned char* end = p + ks_len(data);
+    uint32_t gzipped = 0;
+    uint64_t count = 0;
+    struct stat info;
+    bool valid = ks_len(data) >= 4 && memcmp(p, SEEK_MAGIC, 4) == 0;
+    p += 4;
+    valid = valid && get32(&p, end, &gzipped) && get64(&p, end, &(index -> fileSize)) && get64(&p, end, &count);
+    index -> gzipped = gzipped;
+    for (uint64_t i = 0; valid && i < count; i++) {
+        AccessPoint_t point;
+        uint32_t bits, windowLength;
+        valid = get64(&p, end, &point.out) && get64(&p, end, &point.in) && get32(&p, end, &bits) && get32(&p, end, &windowLength) && bits < 8 && windowLength <= end - p;
+        if (!valid)
+            break;
+        point.bits = bits;
+        point.windowLength = windowLength;
+        point.window = malloc(windowLength);
+        memcpy(point.window, p, windowLength);
+        p += windowLength;
+        kv_push(AccessPoint_t, index -> points, point);
+    }
+    valid = valid && get64(&p, end, &count) && count <= (uint64_t) (end - p) / 8;
+    for (uint64_t i = 0; valid && i < count; i++) {
+        uint64_t offset = 0;
+        get64(&p, end, &offset);
+        kv_push(uint64_t, index -> replicates, offset);
+    }
+    // The sidecar must describe the file as it is now.
+    valid = valid && fstat(fd, &info) == 0 && (uint64_t) info.st_size == index -> fileSize;
+    destroy_kstring(data);
+    if (!valid) {
+        destroy_seek_index(index);
+        return NULL;
+    }
+    return index;
+}
+
+void destroy_seek_index(SeekIndex_t* index) {
+    if (index == NULL)
+        return;
+    for (int i = 0; i < kv_size(index -> points); i++)
+        free(kv_A(index -> points, i).window);
+    kv_destroy(index -> points);
+    kv_destroy(index -> replicates);
+    free(index);
+}
+
+Inflater_t* init_inflater(int fd, SeekIndex_t* index, uint64_t offset) {
+    // Find the last access point at or before the offset.
+    AccessPoint_t* point = NULL;
+    int low = 0, high = kv_size(index -> points);
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (kv_A(index -> points, mid).out <= offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low > 0)
+        point = &kv_A(index -> points, low - 1);
+
+    Inflater_t* inflater = calloc(1, sizeof(Inflater_t));
+    inflater -> fd = fd;
+    inflater -> input = malloc(SEEK_CHUNK);
+    bool success;
+    if (point == NULL) {
+        // Start from the gzip header.
+        success = lseek(fd, 0, SEEK_SET) == 0 && inflateInit2(&(inflater -> stream), 31) == Z_OK;
+    } else {
+        // Restart inside the member. A boundary that is not byte aligned
+        //  needs the bits of the previous byte that belong to the next block.
+        inflater -> raw = true;
+        unsigned char previous, dictionary[SEEK_WINDOW];
+        uLongf dictionaryLength = SEEK_WINDOW;
+        success = lseek(fd, point -> in - (point -> bits ? 1 : 0), SEEK_SET) >= 0
+            && inflateInit2(&(inflater -> stream), -15) == Z_OK
+            && (point -> bits == 0 || (read(fd, &previous, 1) == 1 && inflatePrime(&(inflater -> stream), point -> bits, previous >> (8 - point -> bits)) == Z_OK))
+            && uncompress(dictionary, &dictionaryLength, point -> window, point -> windowLength) == Z_OK
+            && inflateSetDictionary(&(inflater -> stream), dictionary, dictionaryLength) == Z_OK;
+    }
+    // Skip to the offset.
+    uint64_t skip = offset - (point == NULL ? 0 : point -> out);
+    char scratch[16384];
+    while (success && skip > 0) {
+        int n = read_inflater(inflater, scratch, skip < sizeof(scratch) ? skip : sizeof(scratch));
+        success = n > 0;
+        skip -= n > 0 ? n : 0;
+    }
+    if (!success) {
+        destroy_inflater(inflater);
+        return NULL;
+    }
+    return inflater;
+}
+
+int read_inflater(Inflater_t* inflater, void* buf, int size) {
+    if (inflater -> eof)
+        return 0;
+    z_stream* stream = &(inflater -> stream);
+    stream -> next_out = buf;
+    stream -> avail_out = size;
+    while (stream -> avail_out > 0) {
+        if (stream -> avail_in == 0) {
+            ssize_t n = read(inflater -> fd, inflater -> input, SEEK_CHUNK);
+            if (n < 0)
+                return -1;
+            if (n == 0) {
+                inflater -> eof = true;
+                break;
+            }
+            stream -> next_in = inflater -> input;
+            stream -> avail_in = n;
+        }
+        // A member inflated without its header leaves its trailer unread.
+        if (inflater -> trailer > 0) {
+            int n = inflater -> trailer < stream -> avail_in ? inflater -> trailer : stream -> avail_in;
+            stream -> next_in += n;
+            stream -> avail_in -= n;
+            inflater -> trailer -= n;
+            if (inflater -> trailer == 0) {
+                inflateReset2(stream, 31);
+                inflater -> raw = false;
+            }
+            continue;
+        }
+        int ret = inflate(stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            // Another member may follow.
+            if (inflater -> raw)
+                inflater -> trailer = GZIP_TRAILER;
+            else
+                inflateReset(stream);
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            // Like gzread, data that does not inflate ends the file.
+            inflater -> eof = true;
+            break;
+        }
+    }
+    return size - stream -> avail_out;
+}
+
+void destroy_inflater(Inflater_t* inflater) {
+    if (inflater == NULL)
+        return;
+    inflateEnd(&(inflater -> stream));
+    free(inflater -> input);
+    free(inflater);
+}
@@ -0,0 +1,108 @@
+// File: Seek.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Random access into ms files through a sidecar of replicate offsets and gzip access points.
+
+#ifndef _SEEK_H_
+#define _SEEK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "../lib/zlib.h"
+#include "../lib/kvec.h"
+#include "../lib/kstring.h"
+
+// The extension of the sidecar written next to the ms file.
+#define SEEK_EXTENSION ".msi"
+
+// Inflate can refer back at most this many bytes.
+#define SEEK_WINDOW 32768
+
+// The number of uncompressed bytes between access points.
+#define SEEK_SPAN 16777216
+
+// A place in a gzipped file where inflate can be restarted. Access points
+//  lie on deflate block boundaries, which need not be byte aligned.
+typedef struct {
+    // The offset in the uncompressed data.
+    uint64_t out;
+    // The offset of the first whole compressed byte after the boundary.
+    uint64_t in;
+    // The number of bits of the previous byte that belong to the next block.
+    int bits;
+    // The 32 KiB of uncompressed data before the point, deflated to save space.
+    unsigned char* window;
+    int windowLength;
+} AccessPoint_t;
+
+// The sidecar of an ms file.
+typedef struct {
+    bool gzipped;
+    // The size of the indexed file, used to detect a stale sidecar.
+    uint64_t fileSize;
+    kvec_t(AccessPoint_t) points;
+    // The uncompressed offset of each replicate's "//" line.
+    kvec_t(uint64_t) replicates;
+} SeekIndex_t;
+
+// An inflate stream restarted from an access point.
+typedef struct Inflater_t Inflater_t;
+
+// Index an ms file in a single pass.
+// Accepts:
+//  const char* fileName -> The plain or gzipped ms file.
+//  uint64_t span -> The number of uncompressed bytes between access points.
+// Returns: SeekIndex_t*, the index or NULL if the file could not be read.
+SeekIndex_t* build_seek_index(const char* fileName, uint64_t span);
+
+// Write the sidecar of an ms file.
+// Accepts:
+//  SeekIndex_t* index -> The index.
+//  const char* fileName -> The name of the sidecar.
+// Returns: bool, true on success.
+bool write_seek_index(SeekIndex_t* index, const char* fileName);
+
+// Read the sidecar of an ms file.
+// Accepts:
+//  const char* fileName -> The name of the sidecar.
+//  int fd -> The open ms file the sidecar should describe.
+// Returns: SeekIndex_t*, the index or NULL if it is missing, malformed, or stale.
+SeekIndex_t* read_seek_index(const char* fileName, int fd);
+
+// Free an index.
+// Accepts:
+//  SeekIndex_t* index -> The index.
+// Returns: void.
+void destroy_seek_index(SeekIndex_t* index);
+
+// Start inflating a gzipped file at an uncompressed offset. Inflate restarts
+//  from the closest access point before the offset and skips the rest.
+// Accepts:
+//  int fd -> The open gzipped file. It is repositioned.
+//  SeekIndex_t* index -> The index of the file.
+//  uint64_t offset -> The uncompressed offset to start at.
+// Returns: Inflater_t*, the stream or NULL if the file could not be read.
+Inflater_t* init_inflater(int fd, SeekIndex_t* index, uint64_t offset);
+
+// Read uncompressed bytes. Fills buf unless the end of the file is reached.
+// Accepts:
+//  Inflater_t* inflater -> The stream.
+//  void* buf -> The destination.
+//  int size -> The number of bytes requested.
+// Returns: int, the number of bytes read, 0 at the end of the file, or -1 on error.
+int read_inflater(Inflater_t* inflater, void* buf, int size);
+
+// Free an inflate stream. The file is left open.
+// Accepts:
+//  Inflater_t* inflater -> The stream.
+// Returns: void.
+void destroy_inflater(Inflater_t* inflater);
+
+#endif
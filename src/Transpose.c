@@ -0,0 +1,101 @@
+// File: Transpose.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Cache-blocked transpose of the haplotype matrix into site-major rows.
+
+#include "Transpose.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The number of haplotypes in a tile.
+#define TILE_SIZE 64
+
+#ifdef __SSE2__
+// Transposes a 16 x 16 byte tile using SSE2.
+//  Interleaving row i with row i + 8 rotates the 8-bit (row, column)
+//  index of each byte left by one, so four rounds swap row and column.
+// Accepts:
+//  const char** rows -> Pointers to the 16 haplotypes of the tile.
+//  int site -> The first site of the tile.
+//  char* dst -> The destination of the first site.
+//  int dstStride -> The distance in bytes between consecutive sites in dst.
+// Returns: void.
+static inline void transpose_16x16(const char** rows, int site, char* dst, int dstStride) {
+    __m128i x[16], y[16];
+    for (int i = 0; i < 16; i++)
+        x[i] = _mm_loadu_si128((const __m128i*) (rows[i] + site));
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 8; i++) {
+            y[2 * i] = _mm_unpacklo_epi8(x[i], x[i + 8]);
+            y[2 * i + 1] = _mm_unpackhi_epi8(x[i], x[i + 8]);
+        }
+        memcpy(x, y, sizeof(x));
+    }
+    for (int i = 0; i < 16; i++)
+        _mm_storeu_si128((__m128i*) (dst + i * dstStride), x[i]);
+}
+#endif
+
+// Transposes one tile with scalar loads.
+// Accepts:
+//  const char** rows -> Pointers to the haplotypes of the tile.
+//  int numRows -> The number of haplotypes in the tile.
+//  int site -> The first site of the tile.
+//  int numSites -> The number of sites in the tile.
+//  char* dst -> The destination of the first haplotype at the first site.
+//  int dstStride -> The distance in bytes between consecutive sites in dst.
+// Returns: void.
+static inline void transpose_scalar(const char** rows, int numRows, int site, int numSites, char* dst, int dstStride) {
+    for (int r = 0; r < numRows; r++)
+        for (int c = 0; c < numSites; c++)
+            dst[c * dstStride + r] = rows[r][site + c];
+}
+
+void transpose_block(const char** rows, int numRows, int firstSite, int numSites, char* dst, int dstStride) {
+    for (int r0 = 0; r0 < numRows; r0 += TILE_SIZE) {
+        int tileRows = numRows - r0 < TILE_SIZE ? numRows - r0 : TILE_SIZE;
+        int r = 0;
+        #ifdef __SSE2__
+        for (; r + 16 <= tileRows; r += 16) {
+            int c = 0;
+            for (; c + 16 <= numSites; c += 16)
+                transpose_16x16(rows + r0 + r, firstSite + c, dst + c * dstStride + r0 + r, dstStride);
+            transpose_scalar(rows + r0 + r, 16, firstSite + c, numSites - c, dst + c * dstStride + r0 + r, dstStride);
+        }
+        #endif
+        transpose_scalar(rows + r0 + r, tileRows - r, firstSite, numSites, dst + r0 + r, dstStride);
+    }
+}
+
+// Transposes a 64 x 64 bit matrix in place, so bit j of a[i] is swapped with bit i of a[j].
+//  Each round swaps the off-diagonal blocks of the next smaller block size.
+// Accepts:
+//  uint64_t* a -> The 64 rows of the matrix.
+// Returns: void.
+static inline void transpose_64x64(uint64_t* a) {
+    uint64_t mask = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & mask;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+void transpose_bits_block(const uint64_t** rows, int numRows, int word, int numSites, uint64_t* dst, int dstStride) {
+    uint64_t tile[64];
+    for (int r0 = 0; r0 < numRows; r0 += 64) {
+        int tileRows = numRows - r0 < 64 ? numRows - r0 : 64;
+        for (int r = 0; r < tileRows; r++)
+            tile[r] = rows[r0 + r][word];
+        for (int r = tileRows; r < 64; r++)
+            tile[r] = 0;
+        transpose_64x64(tile);
+        for (int s = 0; s < numSites; s++)
+            dst[(size_t) s * dstStride + r0 / 64] = tile[s];
+    }
+}
@@ -0,0 +1,42 @@
+// File: Transpose.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Cache-blocked transpose of the haplotype matrix into site-major rows.
+
+#ifndef _TRANSPOSE_H_
+#define _TRANSPOSE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// The number of sites transposed at a time. A block of sites
+//  times a tile of haplotypes fits comfortably in L1 cache.
+#define TRANSPOSE_BLOCK 64
+
+// Transposes a block of sites from haplotype-major rows into site-major rows.
+//  After the call, dst[(c - firstSite) * dstStride + r] == rows[r][c].
+// Accepts:
+//  const char** rows -> The haplotypes, one row per haplotype.
+//  int numRows -> The number of haplotypes.
+//  int firstSite -> The first site of the block.
+//  int numSites -> The number of sites in the block.
+//  char* dst -> The site-major destination.
+//  int dstStride -> The distance in bytes between consecutive sites in dst.
+// Returns: void.
+void transpose_block(const char** rows, int numRows, int firstSite, int numSites, char* dst, int dstStride);
+
+// Transposes one 64-site word of packed haplotypes into packed site rows.
+//  After the call, bit r % 64 of dst[s * dstStride + r / 64] is bit s of rows[r][word].
+// Accepts:
+//  const uint64_t** rows -> The packed haplotypes, one bitset per haplotype.
+//  int numRows -> The number of haplotypes.
+//  int word -> The index of the word holding the block of sites.
+//  int numSites -> The number of sites in the block, at most 64.
+//  uint64_t* dst -> The packed site-major destination.
+//  int dstStride -> The distance in words between consecutive sites in dst.
+// Returns: void.
+void transpose_bits_block(const uint64_t** rows, int numRows, int word, int numSites, uint64_t* dst, int dstStride);
+
+#endif
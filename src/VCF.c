@@ -0,0 +1,700 @@
+// File: VCF.c
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Format ms replicates as VCF records.
+
+#include "VCF.h"
+#include "Transpose.h"
+#include "BCF.h"
+#include "Random.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The fixed columns of every record following POS.
+#define RECORD_COLUMNS "\t.\tA\tT\t.\t.\t.\t."
+
+// How the genotypes of a record are laid out. Each individual has a fixed width cell,
+//  "\tA|B" in VCF or two encoded GT values in BCF.
+typedef struct {
+    bool bcf;
+    bool unphased;
+    double missing;
+    // The log of the probability an allele is not missing.
+    double logPresent;
+    int numIndividuals;
+    // The contig of the records and its id in the header.
+    const char* chrom;
+    int tid;
+    // The number of bytes in a cell.
+    int width;
+    // The cells of a record where every allele is '0'.
+    char* template;
+} RecordFormat_t;
+
+// Gets the byte holding an allele of a haplotype within a record's cells.
+// Accepts:
+//  RecordFormat_t* format -> The layout of the record.
+//  char* cells -> The first cell of the record.
+//  int h -> The haplotype.
+// Returns: char*, the byte holding the allele.
+static inline char* get_allele(RecordFormat_t* format, char* cells, int h) {
+    return cells + format -> width * (h / 2) + (format -> bcf ? (h & 1) : 1 + 2 * (h & 1));
+}
+
+// Encodes an allele for a haplotype.
+// Accepts:
+//  RecordFormat_t* format -> The layout of the record.
+//  int h -> The haplotype.
+//  char allele -> The allele as it appears in VCF.
+// Returns: char, the byte to store.
+static inline char encode_allele(RecordFormat_t* format, int h, char allele) {
+    if (format -> bcf)
+        return encode_bcf_allele(allele, (h & 1) && !format -> unphased);
+    return allele;
+}
+
+// Creates the layout of the records of a replicate.
+// Accepts:
+//  bool bcf -> If set, records are BCF.
+//  bool unphased -> If set, the genotypes are unphased.
+//  double missing -> The probability an allele is missing.
+//  int numIndividuals -> The number of diploid individuals.
+// Returns: RecordFormat_t*, the layout.
+static RecordFormat_t* init_record_format(bool bcf, bool unphased, double missing, int numIndividuals) {
+    RecordFormat_t* format = calloc(1, sizeof(RecordFormat_t));
+    format -> bcf = bcf;
+    format -> unphased = unphased;
+    format -> missing = missing;
+    format -> logPresent = log1p(-missing);
+    format -> numIndividuals = numIndividuals;
+    format -> chrom = "chr1";
+    format -> tid = 0;
+    format -> width = bcf ? 2 : 4;
+    // Most alleles are '0', so records start as a copy of the template.
+    format -> template = malloc(format -> width * numIndividuals);
+    for (int j = 0; j < numIndividuals; j++) {
+        if (!bcf) {
+            char* cell = format -> template + 4 * j;
+            cell[0] = '\t';
+            cell[2] = unphased ? '/' : '|';
+        }
+        for (int a = 0; a < 2; a++)
+            *get_allele(format, format -> template, 2 * j + a) = encode_allele(format, 2 * j + a, '0');
+    }
+    return format;
+}
+
+// Frees the layout of a replicate's records.
+static void destroy_record_format(RecordFormat_t* format) {
+    free(format -> template);
+    free(format);
+}
+
+// Appends the header to the buffer. A file per replicate has the contig chr1,
+//  and the current file of a stream has one contig per replicate it can hold.
+// Accepts:
+//  kstring_t* buffer -> The buffer to append to.
+//  RecordFormat_t* format -> The layout of the records.
+//  VCFConfig_t* config -> The output options.
+// Returns: void.
+static void format_header(kstring_t* buffer, RecordFormat_t* format, VCFConfig_t* config) {
+    kstring_t* text = format -> bcf ? init_kstring(NULL) : buffer;
+    kputs("##fileformat=VCFv4.2\n", text);
+    if (format -> bcf)
+        kputs(BCF_HEADER_LINES, text);
+    if (config -> stream == NULL) {
+        kputs("##contig=<ID=chr1,length=", text); kputw(config -> length, text); kputs(">\n", text);
+    } else {
+        VCFStream_t* stream = config -> stream;
+        for (int i = stream -> firstContig; i < stream -> firstContig + stream -> numContigs; i++) {
+            kputs("##contig=<ID=rep", text); kputw(i, text);
+            kputs(",length=", text); kputw(config -> length, text); kputs(">\n", text);
+        }
+    }
+    kputs("#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT", text);
+    for (int i = 0; i < format -> numIndividuals; i++) {
+        kputs("\ts", text); kputw(i, text);
+    }
+    kputc('\n', text);
+    if (format -> bcf) {
+        format_bcf_header(buffer, text);
+        destroy_kstring(text);
+    }
+}
+
+// Appends the fields of a record that precede the genotypes and fills its cells from the template.
+// Accepts:
+//  kstring_t* buffer -> The buffer to append to.
+//  RecordFormat_t* format -> The layout of the record.
+//  int pos -> The position of the record.
+// Returns: char*, the first cell of the record.
+static char* start_record(kstring_t* buffer, RecordFormat_t* format, int pos) {
+    if (format -> bcf) {
+        format_bcf_prefix(buffer, format -> tid, pos, format -> numIndividuals);
+    } else {
+        kputs(format -> chrom, buffer);
+        kputc('\t', buffer);
+        kputw(pos, buffer);
+        kputsn(RECORD_COLUMNS, sizeof(RECORD_COLUMNS) - 1, buffer);
+    }
+    // Reserve the cells, the newline, and the terminator.
+    ks_resize(buffer, ks_len(buffer) + format -> width * format -> numIndividuals + 2);
+    char* cells = ks_str(buffer) + ks_len(buffer);
+    memcpy(cells, format -> template, format -> width * format -> numIndividuals);
+    return cells;
+}
+
+// Commits the cells of a record to the buffer.
+// Accepts:
+//  kstring_t* buffer -> The buffer holding the record.
+//  RecordFormat_t* format -> The layout of the record.
+// Returns: void.
+static void end_record(kstring_t* buffer, RecordFormat_t* format) {
+    buffer -> l += format -> width * format -> numIndividuals;
+    if (!format -> bcf)
+        buffer -> s[buffer -> l++] = '\n';
+    buffer -> s[buffer -> l] = '\0';
+}
+
+// Blanks out the missing alleles of a record. Rather than a trial per allele,
+//  the gaps between missing alleles are drawn from a geometric distribution,
+//  so the work scales with the number of missing alleles.
+// Accepts:
+//  RecordFormat_t* format -> The layout of the record.
+//  char* cells -> The first cell of the record.
+//  Random_t* missing -> The site's stream for choosing missing alleles.
+// Returns: void.
+static void blank_missing(RecordFormat_t* format, char* cells, Random_t* missing) {
+    if (format -> missing <= 0)
+        return;
+    int numAlleles = 2 * format -> numIndividuals;
+    for (int h = next_geometric(missing, format -> logPresent, numAlleles); h < numAlleles; h += 1 + next_geometric(missing, format -> logPresent, numAlleles))
+        *get_allele(format, cells, h) = encode_allele(format, h, '.');
+}
+
+// Overwrites one allele of a record started from the template.
+// Accepts:
+//  RecordFormat_t* format -> The layout of the record.
+//  char* cells -> The first cell of the record.
+//  int h -> The haplotype carrying the allele.
+//  char allele -> The allele as it appears in VCF.
+//  const uint64_t* coins -> If unphased, bit j % 64 of word j / 64 swaps individual j.
+// Returns: void.
+static inline void patch_allele(RecordFormat_t* format, char* cells, int h, char allele, const uint64_t* coins) {
+    // The template holds '0' in both slots of an individual, so a swap only
+    //  has to move the alleles that differ from it to the other slot.
+    if (format -> unphased)
+        h ^= (coins[h / 128] >> ((h / 2) % 64)) & 1;
+    *get_allele(format, cells, h) = encode_allele(format, h, allele);
+}
+
+// Appends one record to the buffer.
+// Accepts:
+//  kstring_t* buffer -> The buffer to append to.
+//  RecordFormat_t* format -> The layout of the record.
+//  int pos -> The position of the record.
+//  const char* genotypes -> The alleles of every haplotype at the site.
+//  const uint64_t* coins -> If unphased, bit j % 64 of word j / 64 swaps individual j.
+//  Random_t* missing -> The site's stream for choosing missing alleles.
+// Returns: void.
+static void format_record(kstring_t* buffer, RecordFormat_t* format, int pos, const char* genotypes, const uint64_t* coins, Random_t* missing) {
+    char* cells = start_record(buffer, format, pos);
+    int numAlleles = 2 * format -> numIndividuals;
+    int h = 0;
+    #ifdef __SSE2__
+    // Find the alleles that are not '0' sixteen at a time.
+    const __m128i zeros = _mm_set1_epi8('0');
+    for (; h + 16 <= numAlleles; h += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) (genotypes + h));
+        unsigned derived = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, zeros)) & 0xFFFF;
+        for (; derived != 0; derived &= derived - 1) {
+            int k = h + __builtin_ctz(derived);
+            patch_allele(format, cells, k, genotypes[k], coins);
+        }
+    }
+    #endif
+    for (; h < numAlleles; h++)
+        if (genotypes[h] != '0')
+            patch_allele(format, cells, h, genotypes[h], coins);
+    blank_missing(format, cells, missing);
+    end_record(buffer, format);
+}
+
+// Appends one record of a packed replicate to the buffer.
+// Accepts:
+//  kstring_t* buffer -> The buffer to append to.
+//  RecordFormat_t* format -> The layout of the record.
+//  int pos -> The position of the record.
+//  const uint64_t* genotypes -> The packed alleles of every haplotype at the site.
+//  Allele_t* exceptions -> The non-binary alleles at the site.
+//  int numExceptions -> The number of non-binary alleles at the site.
+//  const uint64_t* coins -> If unphased, bit j % 64 of word j / 64 swaps individual j.
+//  Random_t* missing -> The site's stream for choosing missing alleles.
+// Returns: void.
+static void format_packed_record(kstring_t* buffer, RecordFormat_t* format, int pos, const uint64_t* genotypes, Allele_t* exceptions, int numExceptions, const uint64_t* coins, Random_t* missing) {
+    char* cells = start_record(buffer, format, pos);
+    int numAlleles = 2 * format -> numIndividuals;
+    // Patch the '1' alleles a word of the site row at a time.
+    for (int w = 0; 64 * w < numAlleles; w++) {
+        for (uint64_t m = genotypes[w]; m != 0; m &= m - 1) {
+            int h = 64 * w + __builtin_ctzll(m);
+            if (h >= numAlleles) break;
+            patch_allele(format, cells, h, '1', coins);
+        }
+    }
+    // Then the non-binary alleles.
+    for (int e = 0; e < numExceptions; e++)
+        if (exceptions[e].haplotype < numAlleles)
+            patch_allele(format, cells, exceptions[e].haplotype, exceptions[e].allele, coins);
+    blank_missing(format, cells, missing);
+    end_record(buffer, format);
+}
+
+// The index entry of a record, with offsets from the start of its replicate's records.
+typedef struct {
+    int pos;
+    uint64_t start;
+    uint64_t end;
+} IndexEntry_t;
+
+typedef kvec_t(IndexEntry_t) IndexEntries_t;
+
+// Appends every record of a replicate to a buffer.
+// Accepts:
+//  VCFConfig_t* config -> The output options.
+//  Replicate_t* replicate -> The parsed replicate.
+//  RecordFormat_t* format -> The layout of the records.
+//  kstring_t* buffer -> The buffer to append to.
+//  Output_t* output -> The output flushed each time buffer fills a block, or NULL to keep every record in buffer.
+//  IndexEntries_t* entries -> If not NULL, the index entry of each record is appended.
+// Returns: void.
+static void format_records(VCFConfig_t* config, Replicate_t* replicate, RecordFormat_t* format, kstring_t* buffer, Output_t* output, IndexEntries_t* entries) {
+    int length = config -> length;
+    int numSegsites = replicate -> numSegsites, numSamples = replicate -> numSamples;
+    uint64_t base = (output != NULL ? output -> offset : 0) + ks_len(buffer);
+
+    // Sites are transposed a block at a time so each record is built from contiguous memory.
+    //  Packed replicates are transposed into site rows of numWords 64-bit words.
+    int numWords = (numSamples + 63) / 64;
+    const char** rows = malloc(numSamples * sizeof(char*));
+    for (int j = 0; j < numSamples; j++)
+        rows[j] = get_row(replicate, j);
+    char* block = NULL;
+    uint64_t* packedBlock = NULL;
+    // One coin per individual for scrambling the phase.
+    int numCoinWords = (numSamples / 2 + 63) / 64;
+    uint64_t* coins = malloc(numCoinWords * sizeof(uint64_t));
+    int nextException = 0;
+    if (replicate -> packed) {
+        packedBlock = malloc((size_t) TRANSPOSE_BLOCK * numWords * sizeof(uint64_t));
+    } else {
+        block = malloc((size_t) TRANSPOSE_BLOCK * numSamples);
+    }
+
+    // Process each record.
+    int prevPosition = 0, pos;
+    for (int first = 0; first < numSegsites; first += TRANSPOSE_BLOCK) {
+        int numSites = numSegsites - first < TRANSPOSE_BLOCK ? numSegsites - first : TRANSPOSE_BLOCK;
+        if (replicate -> packed)
+            transpose_bits_block((const uint64_t**) rows, numSamples, first / 64, numSites, packedBlock, numWords);
+        else
+            transpose_block(rows, numSamples, first, numSites, block, numSamples);
+        for (int i = 0; i < numSites; i++) {
+            pos = (int) (kv_A(replicate -> positions, first + i) * length);
+            // Make sure the positions are unique.
+            if (pos == prevPosition) { pos += 1; }
+            prevPosition = pos;
+            uint64_t start = (output != NULL ? output -> offset : 0) + ks_len(buffer);
+            // Each site draws from its own streams, so the output does not depend on how work is split.
+            Random_t phase, missing;
+            if (config -> unphased) {
+                init_random(&phase, config -> seed, replicate -> numReplicate, first + i, STREAM_PHASE);
+                fill_random(&phase, coins, numCoinWords);
+            }
+            init_random(&missing, config -> seed, replicate -> numReplicate, first + i, STREAM_MISSING);
+            if (replicate -> packed) {
+                // Gather the non-binary alleles at this site.
+                int numExceptions = 0;
+                while (nextException + numExceptions < kv_size(replicate -> exceptions) && kv_A(replicate -> exceptions, nextException + numExceptions).site == first + i)
+                    numExceptions++;
+                format_packed_record(buffer, format, pos, packedBlock + (size_t) i * numWords, replicate -> exceptions.a + nextException, numExceptions, coins, &missing);
+                nextException += numExceptions;
+            } else {
+                format_record(buffer, format, pos, block + (size_t) i * numSamples, coins, &missing);
+            }
+            if (entries != NULL) {
+                IndexEntry_t entry = { pos, start - base, (output != NULL ? output -> offset : 0) + ks_len(buffer) - base };
+                kv_push(IndexEntry_t, *entries, entry);
+            }
+            if (output != NULL && ks_len(buffer) >= OUTPUT_BLOCK_SIZE)
+                flush_output(output);
+            // A spill output that failed would only drop the rest.
+            if (output != NULL && output -> failed)
+                break;
+        }
+        if (output != NULL && output -> failed)
+            break;
+    }
+
+    free(rows);
+    free(block);
+    free(packedBlock);
+    free(coins);
+}
+
+// Adds the records of a replicate to an index.
+// Accepts:
+//  Index_t* index -> The index.
+//  int tid -> The contig of the records.
+//  IndexEntries_t* entries -> The index entries of the records.
+//  uint64_t base -> The uncompressed offset of the first record.
+// Returns: void.
+static void add_index_entries(Index_t* index, int tid, IndexEntries_t* entries, uint64_t base) {
+    for (int i = 0; i < kv_size(*entries); i++) {
+        IndexEntry_t* entry = &kv_A(*entries, i);
+        add_index_record(index, tid, entry -> pos - 1, entry -> pos, base + entry -> start, base + entry -> end);
+    }
+}
+
+// Gets the extension of the output files.
+// Accepts:
+//  VCFConfig_t* config -> The output options.
+// Returns: const char*, the extension.
+static const char* get_extension(VCFConfig_t* config) {
+    if (config -> bcf)
+        return ".bcf";
+    if (!config -> compress)
+        return ".vcf";
+    return config -> compression.format == FORMAT_ZSTD ? ".vcf.zst" : ".vcf.gz";
+}
+
+// Opens the file of a stream that holds a shard, creating its directories.
+//  Shard 0 of a single file stream holds every replicate.
+// Accepts:
+//  VCFConfig_t* config -> The output options holding the stream.
+//  int shard -> The shard.
+// Returns: bool, true if the file was created.
+static bool open_shard(VCFConfig_t* config, int shard) {
+    VCFStream_t* stream = config -> stream;
+    stream -> shard = shard;
+    stream -> numIndividuals = -1;
+    kv_size(stream -> manifest) = 0;
+    stream -> fileName -> l = 0;
+    kputs(config -> outputBase, stream -> fileName);
+    if (stream -> perFile == 0) {
+        stream -> firstContig = 0;
+        stream -> numContigs = stream -> numReplicates;
+    } else {
+        stream -> firstContig = shard * stream -> perFile;
+        stream -> numContigs = stream -> perFile;
+        if (stream -> numReplicates > 0 && stream -> numReplicates - stream -> firstContig < stream -> numContigs)
+            stream -> numContigs = stream -> numReplicates - stream -> firstContig;
+        kputs("_shards", stream -> fileName);
+        mkdir(ks_str(stream -> fileName), 0777);
+        kputc('/', stream -> fileName); kputw(shard / SHARDS_PER_DIRECTORY, stream -> fileName);
+        mkdir(ks_str(stream -> fileName), 0777);
+        kputs("/shard", stream -> fileName); kputw(shard, stream -> fileName);
+    }
+    if (strcmp(config -> outputBase, "-") != 0 || stream -> perFile > 0)
+        kputs(get_extension(config), stream -> fileName);
+    stream -> output = init_output(ks_str(stream -> fileName), config -> compress, config -> compression, config -> pipelined, config -> pool);
+    if (stream -> output == NULL)
+        return false;
+    if (config -> index) {
+        stream -> index = init_index(config -> bcf, !config -> bcf, config -> length);
+        kstring_t* name = init_kstring(NULL);
+        for (int i = stream -> firstContig; i < stream -> firstContig + stream -> numContigs; i++) {
+            name -> l = 0;
+            kputs("rep", name); kputw(i, name);
+            add_index_reference(stream -> index, ks_str(name));
+        }
+        destroy_kstring(name);
+    }
+    return true;
+}
+
+// Writes the manifest of the current file of a sharded stream, fileName.manifest. Each line
+//  is a replicate's contig, the offsets of its first record and one past its last, and its
+//  number of records. Offsets are BGZF virtual offsets in BGZF files and uncompressed byte offsets
+//  otherwise, which the seek table of a zstd file maps to frames. A replicate without records
+//  has no offsets to give, so both are written as ".".
+// Accepts:
+//  VCFConfig_t* config -> The output options holding the stream.
+// Returns: bool, true on success.
+static bool write_manifest(VCFConfig_t* config) {
+    VCFStream_t* stream = config -> stream;
+    bool virtualOffsets = config -> compress && config -> compression.format == FORMAT_BGZF;
+    kstring_t* text = init_kstring(virtualOffsets ? "#contig\tvirtual_start\tvirtual_end\tsites\n" : "#contig\tstart\tend\tsites\n");
+    for (int i = 0; i < kv_size(stream -> manifest); i++) {
+        ManifestEntry_t* entry = &kv_A(stream -> manifest, i);
+        uint64_t start = virtualOffsets ? get_virtual_offset(stream -> output -> bgzf, entry -> start) : entry -> start;
+        uint64_t end = virtualOffsets ? get_virtual_offset(stream -> output -> bgzf, entry -> end) : entry -> end;
+        kputs("rep", text); kputw(entry -> numReplicate, text);
+        if (entry -> numSites == 0) {
+            kputs("\t.\t.", text);
+        } else {
+            kputc('\t', text); kputl((long) start, text);
+            kputc('\t', text); kputl((long) end, text);
+        }
+        kputc('\t', text); kputw(entry -> numSites, text);
+        kputc('\n', text);
+    }
+    kstring_t* fileName = init_kstring(ks_str(stream -> fileName));
+    kputs(".manifest", fileName);
+    FILE* fp = fopen(ks_str(fileName), "w");
+    bool written = fp != NULL && fwrite(ks_str(text), 1, ks_len(text), fp) == ks_len(text);
+    if (fp != NULL && fclose(fp) != 0)
+        written = false;
+    destroy_kstring(fileName);
+    destroy_kstring(text);
+    return written;
+}
+
+// Finishes the current file of a stream and writes its index and manifest.
+// Accepts:
+//  VCFConfig_t* config -> The output options holding the stream.
+// Returns: void.
+static void close_shard(VCFConfig_t* config) {
+    VCFStream_t* stream = config -> stream;
+    if (stream -> output == NULL)
+        return;
+    // Without a single record, the header still has to be written.
+    if (stream -> numIndividuals < 0) {
+        RecordFormat_t* format = init_record_format(config -> bcf, config -> unphased, config -> missing, 0);
+        format_header(stream -> output -> buffer, format, config);
+        destroy_record_format(format);
+    }
+    finish_output(stream -> output);
+    if (stream -> perFile > 0 && !write_manifest(config))
+        fprintf(stderr, "Could not create %s.manifest!\n", ks_str(stream -> fileName));
+    if (stream -> index != NULL) {
+        kputs(get_index_extension(stream -> index), stream -> fileName);
+        if (!write_index(stream -> index, stream -> output -> bgzf, ks_str(stream -> fileName)))
+            fprintf(stderr, "Could not create %s!\n", ks_str(stream -> fileName));
+        destroy_index(stream -> index);
+        stream -> index = NULL;
+    }
+    destroy_output(stream -> output);
+    stream -> output = NULL;
+}
+
+VCFStream_t* init_vcf_stream(VCFConfig_t* config, int perFile, int numReplicates) {
+    VCFStream_t* stream = calloc(1, sizeof(VCFStream_t));
+    stream -> perFile = perFile;
+    stream -> numReplicates = numReplicates;
+    stream -> shard = -1;
+    stream -> fileName = init_kstring(NULL);
+    kv_init(stream -> manifest);
+    pthread_mutex_init(&(stream -> lock), NULL);
+    pthread_cond_init(&(stream -> turn), NULL);
+    config -> stream = stream;
+    if (perFile == 0 && !open_shard(config, 0)) {
+        close_vcf_stream(config);
+        return NULL;
+    }
+    return stream;
+}
+
+void close_vcf_stream(VCFConfig_t* config) {
+    VCFStream_t* stream = config -> stream;
+    if (stream == NULL)
+        return;
+    close_shard(config);
+    pthread_mutex_destroy(&(stream -> lock));
+    pthread_cond_destroy(&(stream -> turn));
+    destroy_kstring(stream -> fileName);
+    kv_destroy(stream -> manifest);
+    free(stream);
+    config -> stream = NULL;
+}
+
+// Appends a replicate to the stream, moving on to the next file when the replicate starts
+//  a new shard. A replicate whose turn has come is formatted straight into the output.
+//  One that arrives early is formatted into a spill output, which keeps a block in memory
+//  and the rest in a temporary file, and is copied over once its turn comes. If the
+//  temporary file fails, the replicate waits for its turn and is formatted straight into
+//  the output instead. Either way, no more than a block and a record of a replicate is held in memory.
+//  Messages go to stderr since the records may be on stdout.
+// Accepts:
+//  VCFConfig_t* config -> The output options holding the stream.
+//  Replicate_t* replicate -> The parsed replicate.
+// Returns: void.
+static void append_to_stream(VCFConfig_t* config, Replicate_t* replicate) {
+    VCFStream_t* stream = config -> stream;
+    // The shard and contig of a replicate only depend on its number.
+    int shard = stream -> perFile == 0 ? 0 : replicate -> numReplicate / stream -> perFile;
+    int tid = stream -> perFile == 0 ? replicate -> numReplicate : replicate -> numReplicate % stream -> perFile;
+    bool declared = stream -> numReplicates == 0 || replicate -> numReplicate < stream -> numReplicates;
+    IndexEntries_t entries;
+    kv_init(entries);
+    RecordFormat_t* format = NULL;
+    char chrom[16];
+    // ms prints no haplotypes without segregating sites, so those replicates have no records.
+    if (declared && replicate -> numSegsites > 0) {
+        snprintf(chrom, sizeof(chrom), "rep%d", replicate -> numReplicate);
+        format = init_record_format(config -> bcf, config -> unphased, config -> missing, replicate -> numSamples / 2);
+        format -> chrom = chrom;
+        format -> tid = tid;
+    }
+
+    // The lock only guards the turn. The replicate whose turn it is owns the output until it passes the turn on.
+    pthread_mutex_lock(&(stream -> lock));
+    bool early = stream -> next != replicate -> sequence;
+    pthread_mutex_unlock(&(stream -> lock));
+    Output_t* spill = NULL;
+    if (early && format != NULL) {
+        spill = init_spill_output();
+        format_records(config, replicate, format, spill -> buffer, spill, config -> index ? &entries : NULL);
+        if (spill -> failed) {
+            fprintf(stderr, "Could not stage replicate %d in a temporary file. Writing it once its turn comes.\n", replicate -> numReplicate);
+            kv_size(entries) = 0;
+            spill -> buffer -> l = 0;
+            destroy_output(spill);
+            spill = NULL;
+        }
+    }
+    pthread_mutex_lock(&(stream -> lock));
+    while (stream -> next != replicate -> sequence)
+        pthread_cond_wait(&(stream -> turn), &(stream -> lock));
+    pthread_mutex_unlock(&(stream -> lock));
+
+    if (declared && shard != stream -> shard) {
+        close_shard(config);
+        if (!open_shard(config, shard))
+            fprintf(stderr, "Could not create %s. Skipping replicates!\n", ks_str(stream -> fileName));
+    }
+    Output_t* output = stream -> output;
+    if (!declared) {
+        fprintf(stderr, "Replicate %d is past the %d replicates in the header. Skipping replicate!\n", replicate -> numReplicate, stream -> numReplicates);
+    } else if (output != NULL) {
+        // The header is written with the first records, which fix the number of individuals.
+        if (format != NULL && stream -> numIndividuals < 0) {
+            format_header(output -> buffer, format, config);
+            write_output_header(output, config -> headerCache);
+            stream -> numIndividuals = format -> numIndividuals;
+        }
+        if (format != NULL && format -> numIndividuals != stream -> numIndividuals) {
+            fprintf(stderr, "Replicate %d has %d individuals instead of %d. Skipping replicate!\n", replicate -> numReplicate, format -> numIndividuals, stream -> numIndividuals);
+        } else {
+            uint64_t base = output -> offset + ks_len(output -> buffer);
+            if (spill != NULL)
+                drain_spill_output(spill, output);
+            else if (format != NULL)
+                format_records(config, replicate, format, output -> buffer, output, config -> index ? &entries : NULL);
+            if (stream -> index != NULL)
+                add_index_entries(stream -> index, tid, &entries, base);
+            if (stream -> perFile > 0) {
+                ManifestEntry_t entry = { replicate -> numReplicate, base, output -> offset + ks_len(output -> buffer), format != NULL ? replicate -> numSegsites : 0 };
+                kv_push(ManifestEntry_t, stream -> manifest, entry);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&(stream -> lock));
+    stream -> next++;
+    pthread_cond_broadcast(&(stream -> turn));
+    pthread_mutex_unlock(&(stream -> lock));
+
+    if (spill != NULL) {
+        // The records of a skipped replicate are dropped rather than spilled.
+        spill -> buffer -> l = 0;
+        destroy_output(spill);
+    }
+    if (format != NULL)
+        destroy_record_format(format);
+    kv_destroy(entries);
+}
+
+// The level and strategy pairs tried by tune_compression.
+static const int TUNE_CANDIDATES[][2] = {
+    { 1, Z_HUFFMAN_ONLY }, { 1, Z_RLE }, { 1, Z_DEFAULT_STRATEGY }, { 2, Z_DEFAULT_STRATEGY },
+    { 3, Z_DEFAULT_STRATEGY }, { 4, Z_DEFAULT_STRATEGY }, { 5, Z_DEFAULT_STRATEGY },
+    { 6, Z_DEFAULT_STRATEGY }, { 7, Z_DEFAULT_STRATEGY }, { 8, Z_DEFAULT_STRATEGY }, { 9, Z_DEFAULT_STRATEGY }
+};
+#define NUM_TUNE_CANDIDATES (sizeof(TUNE_CANDIDATES) / sizeof(TUNE_CANDIDATES[0]))
+
+void tune_compression(VCFConfig_t* config, Replicate_t* replicate, double targetMBps) {
+    if (replicate -> numSegsites == 0 || replicate -> numSamples < 2) {
+        fprintf(stderr, "The first replicate has no records to tune compression on. Keeping level %d with the %s strategy.\n", config -> compression.level, get_strategy_name(config -> compression.strategy));
+        return;
+    }
+    // Only the first sites are formatted, enough to fill the sample.
+    RecordFormat_t* format = init_record_format(config -> bcf, config -> unphased, config -> missing, replicate -> numSamples / 2);
+    Replicate_t sample = *replicate;
+    int numSites = TUNE_SAMPLE_SIZE / (format -> width * format -> numIndividuals + 32) + 1;
+    if (numSites < sample.numSegsites)
+        sample.numSegsites = numSites;
+    kstring_t* records = init_kstring(NULL);
+    format_records(config, &sample, format, records, NULL, NULL);
+
+    // Blocks are compressed in parallel on the pool, if there is one.
+    int numThreads = config -> pool != NULL ? config -> pool -> numThreads : 1;
+    int best = -1;
+    double bestRate = 0;
+    size_t bestLength = 0;
+    for (int i = 0; i < NUM_TUNE_CANDIDATES; i++) {
+        size_t compressedLength;
+        double seconds = time_compression(ks_str(records), ks_len(records), (Compression_t) { FORMAT_BGZF, TUNE_CANDIDATES[i][0], TUNE_CANDIDATES[i][1], false }, &compressedLength);
+        double rate = numThreads * ks_len(records) / (seconds > 0 ? seconds : 1e-9) / 1e6;
+        bool fastEnough = rate >= targetMBps, bestFastEnough = best >= 0 && bestRate >= targetMBps;
+        if (best < 0 || (fastEnough && (!bestFastEnough || compressedLength < bestLength)) || (!fastEnough && !bestFastEnough && rate > bestRate)) {
+            best = i;
+            bestRate = rate;
+            bestLength = compressedLength;
+        }
+    }
+    config -> compression.level = TUNE_CANDIDATES[best][0];
+    config -> compression.strategy = TUNE_CANDIDATES[best][1];
+    // A single file is already open, but nothing has been compressed yet.
+    if (config -> stream != NULL && config -> stream -> output != NULL && config -> compress) {
+        config -> stream -> output -> bgzf -> compression = config -> compression;
+    }
+    fprintf(stderr, "Compressing with level %d and the %s strategy: %.0f MB/s at %.1fx on a %.1f MB sample.\n", config -> compression.level, get_strategy_name(config -> compression.strategy), bestRate, (double) ks_len(records) / bestLength, ks_len(records) / 1e6);
+
+    destroy_kstring(records);
+    destroy_record_format(format);
+}
+
+void toVCF(VCFConfig_t* config, Replicate_t* replicate) {
+    if (config -> stream != NULL) {
+        append_to_stream(config, replicate);
+        return;
+    }
+    // Create the output file name.
+    kstring_t* outputFileName = init_kstring(config -> outputBase);
+    kputs("_rep", outputFileName); kputw(replicate -> numReplicate, outputFileName);
+    kputs(get_extension(config), outputFileName);
+    Output_t* output = init_output(ks_str(outputFileName), config -> compress, config -> compression, config -> pipelined, config -> pool);
+    if (output == NULL) {
+        printf("Could not create %s. Skipping replicate!\n", ks_str(outputFileName));
+        destroy_kstring(outputFileName);
+        return;
+    }
+
+    RecordFormat_t* format = init_record_format(config -> bcf, config -> unphased, config -> missing, replicate -> numSamples / 2);
+    format_header(output -> buffer, format, config);
+    write_output_header(output, config -> headerCache);
+
+    // Records are indexed by their uncompressed offsets as they are formatted.
+    IndexEntries_t entries;
+    kv_init(entries);
+    uint64_t base = output -> offset + ks_len(output -> buffer);
+    format_records(config, replicate, format, output -> buffer, output, config -> index ? &entries : NULL);
+
+    if (config -> index) {
+        Index_t* index = init_index(config -> bcf, !config -> bcf, config -> length);
+        add_index_entries(index, add_index_reference(index, "chr1"), &entries, base);
+        finish_output(output);
+        kputs(get_index_extension(index), outputFileName);
+        if (!write_index(index, output -> bgzf, ks_str(outputFileName)))
+            printf("Could not create %s!\n", ks_str(outputFileName));
+        destroy_index(index);
+    }
+    destroy_output(output);
+    destroy_record_format(format);
+    kv_destroy(entries);
+    destroy_kstring(outputFileName);
+}
@@ -0,0 +1,133 @@
+// File: VCF.h
+// Date: 16 October 2026
+// Author: T. Quinn Smith
+// Principal Investigator: Dr. Zachary A. Szpiech
+// Purpose: Format ms replicates as VCF records.
+
+#ifndef _VCF_H_
+#define _VCF_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "Output.h"
+#include "Replicate.h"
+#include "Index.h"
+#include "../lib/kstring.h"
+#include "../lib/kvec.h"
+
+// The number of bytes of records compressed by each candidate when tuning compression.
+#define TUNE_SAMPLE_SIZE 1048576
+
+// The number of shard files in each directory of a sharded stream.
+#define SHARDS_PER_DIRECTORY 1000
+
+// Where a replicate lies in a file of a stream, listed in the file's manifest.
+typedef struct {
+    int numReplicate;
+    // The uncompressed offsets of the replicate's first record and one past its last.
+    //  Unused without records, since the header may not be written yet.
+    uint64_t start;
+    uint64_t end;
+    int numSites;
+} ManifestEntry_t;
+
+// The output every replicate is appended to in stream mode, either a single file
+//  or a file per perFile replicates. Replicates are formatted in parallel and
+//  appended in the order they were parsed. Replicate N is contig repN.
+typedef struct {
+    // The number of replicates in each file, or 0 for a single file.
+    int perFile;
+    // The number of replicates in the input, or 0 if unknown.
+    int numReplicates;
+    // The current file and its number, or -1 before the first.
+    int shard;
+    Output_t* output;
+    // The name of the current file, "-" for standard output.
+    kstring_t* fileName;
+    // The index of the current file, or NULL.
+    Index_t* index;
+    // The replicates of the current file of a sharded stream.
+    kvec_t(ManifestEntry_t) manifest;
+    // The contigs declared in the header of the current file, repFirstContig onwards.
+    int firstContig;
+    int numContigs;
+    // The number of individuals in the header, or -1 until the header is written.
+    int numIndividuals;
+    // The sequence of the replicate whose turn it is to be appended.
+    int next;
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+} VCFStream_t;
+
+// The user supplied options that control how replicates are written.
+typedef struct {
+    // The base name of the output files.
+    char* outputBase;
+    // The length of the segment in bp.
+    int length;
+    // If set, the resulting output should be unphased.
+    bool unphased;
+    // The probability an allele is missing.
+    double missing;
+    // The seed of the random streams used for phase and missing alleles.
+    uint64_t seed;
+    // If set, the resulting files should be compressed.
+    bool compress;
+    // The format, level, and strategy of compressed files.
+    Compression_t compression;
+    // If set, the resulting files are BCF. BCF files are always compressed.
+    bool bcf;
+    // If set, output blocks are compressed and written on a separate thread.
+    bool pipelined;
+    // The threads compressing BGZF blocks or zstd frames, or NULL.
+    CompressionPool_t* pool;
+    // The compressed header blocks reused across the files of the run, or NULL.
+    HeaderCache_t* headerCache;
+    // If set, a tabix or CSI index is written next to each compressed file.
+    bool index;
+    // The single output of every replicate, or NULL to write a file per replicate.
+    VCFStream_t* stream;
+} VCFConfig_t;
+
+// Start a stream. A single file is outputBase.vcf, .vcf.gz, .vcf.zst, or .bcf, or standard output
+//  if outputBase is "-", and is created immediately. The files of a sharded stream are
+//  created as their first replicate arrives, at outputBase_shards/D/shardS.vcf, where
+//  shard S holds replicates S * perFile onwards and D is S / SHARDS_PER_DIRECTORY.
+//  Headers are written with the first records of each file.
+// Accepts:
+//  VCFConfig_t* config -> The output options.
+//  int perFile -> The number of replicates in each file, or 0 for a single file.
+//  int numReplicates -> The number of replicates in the input, or 0 if unknown. A single file needs it.
+// Returns: VCFStream_t*, the stream or NULL if the single file could not be created.
+VCFStream_t* init_vcf_stream(VCFConfig_t* config, int perFile, int numReplicates);
+
+// Finish the last file of a stream, write its index and manifest, and free the stream.
+// Accepts:
+//  VCFConfig_t* config -> The output options holding the stream.
+// Returns: void.
+void close_vcf_stream(VCFConfig_t* config);
+
+// Pick the compression level and strategy by compressing a sample of a replicate's records under
+//  each candidate. The smallest output compressed at least targetMBps megabytes per second wins,
+//  or the fastest if none is that fast. Must be called before anything is written.
+// Accepts:
+//  VCFConfig_t* config -> The output options. Its BGZF level and strategy are set.
+//  Replicate_t* replicate -> The replicate to sample.
+//  double targetMBps -> The target rate of uncompressed data across the compressing threads.
+// Returns: void.
+void tune_compression(VCFConfig_t* config, Replicate_t* replicate, double targetMBps);
+
+// Prints ms replicate to VCF file, or appends it to the output stream.
+// Accepts:
+//  VCFConfig_t* config -> The output options.
+//  Replicate_t* replicate -> The parsed replicate.
+// Returns: void.
+void toVCF(VCFConfig_t* config, Replicate_t* replicate);
+
+#endif